@@ -131,4 +131,15 @@ For testing the applications, the library provides videos and the corresponding
 #include "markerdetector.h"
 #include "boarddetector.h"
 #include "cvdrawingutils.h"
+#include "dictionary.h"
+#include "codebookoptimizer.h"
+#include "boardrenderer.h"
+#include "markerimagecache.h"
+#include "syntheticframegenerator.h"
+#include "detectionlog.h"
+#include "compiledboard.h"
+#include "overlayrenderer.h"
+#include "posecache.h"
+#include "markerarrays.h"
+#include "rigdetector.h"
 
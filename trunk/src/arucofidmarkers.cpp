@@ -28,6 +28,8 @@ or implied, of Rafael Muñoz Salinas.
 
 */
 #include "arucofidmarkers.h"
+#include "dictionary.h"
+#include "boardrenderer.h"
 #include <opencv2/imgproc/imgproc.hpp>
 using namespace cv;
 using namespace std;
@@ -96,6 +98,19 @@ cv::Mat FiducidalMarkers::getMarkerMat(int id) throw (cv::Exception)
  */
 cv::Mat FiducidalMarkers::createBoardImage(Size gridSize,int MarkerSize,int dist,
   BoardConfiguration& TInfo  ,vector<int> *excludedIds) throw (cv::Exception)
+{
+  Size imageSize;
+  Point origin;
+  createBoardLayout(gridSize,MarkerSize,dist,TInfo,imageSize,origin,excludedIds);
+  return BoardRenderer(TInfo,imageSize,origin).render();
+}
+
+/*!
+ *  
+ */
+void FiducidalMarkers::createBoardLayout(Size gridSize,int MarkerSize,int dist,
+  BoardConfiguration& TInfo,Size &imageSize,Point &origin,vector<int> *excludedIds)
+  throw (cv::Exception)
 {
   srand(cv::getTickCount());
   int nMarkers=gridSize.height*gridSize.width;
@@ -109,18 +124,15 @@ cv::Mat FiducidalMarkers::createBoardImage(Size gridSize,int MarkerSize,int dist
   //find the center so that the ref systeem is in it
   int centerX=sizeX/2;
   int centerY=sizeY/2;
+  imageSize=Size(sizeX,sizeY);
+  origin=Point(centerX,centerY);
 
   //indicate the data is expressed in pixels
   TInfo.mInfoType=BoardConfiguration::PIX;
-  Mat tableImage(sizeY,sizeX,CV_8UC1);
-  tableImage.setTo(Scalar(255));
   int idp=0;
   for (int y=0; y<gridSize.height; y++)
     for (int x=0; x<gridSize.width; x++,idp++)
     {
-      Mat subrect(tableImage,Rect(x*(dist+MarkerSize),y*(dist+MarkerSize),
-        MarkerSize,MarkerSize));
-      Mat marker=createMarkerImage( TInfo[idp].id,MarkerSize);
       //set the location of the corners
       TInfo[idp].resize(4);
       TInfo[idp][0]=cv::Point3f(x*(dist+MarkerSize),y*(dist+MarkerSize),0);
@@ -128,10 +140,7 @@ cv::Mat FiducidalMarkers::createBoardImage(Size gridSize,int MarkerSize,int dist
       TInfo[idp][2]=cv::Point3f(x*(dist+MarkerSize)+MarkerSize,y*(dist+MarkerSize)+MarkerSize,0);
       TInfo[idp][3]=cv::Point3f( x*(dist+MarkerSize),y*(dist+MarkerSize)+MarkerSize,0);
       for (int i=0; i<4; i++) TInfo[idp][i]-=cv::Point3f(centerX,centerY,0);
-      marker.copyTo(subrect);
     }
-
-  return tableImage;
 }
 
 /*!
@@ -139,6 +148,20 @@ cv::Mat FiducidalMarkers::createBoardImage(Size gridSize,int MarkerSize,int dist
  */
 cv::Mat  FiducidalMarkers::createBoardImage_ChessBoard( Size gridSize,int MarkerSize,
   BoardConfiguration& TInfo ,bool centerData ,vector<int> *excludedIds) throw (cv::Exception)
+{
+  Size imageSize;
+  Point origin;
+  createBoardLayout_ChessBoard(gridSize,MarkerSize,TInfo,imageSize,origin,centerData,
+    excludedIds);
+  return BoardRenderer(TInfo,imageSize,origin).render();
+}
+
+/*!
+ *  
+ */
+void FiducidalMarkers::createBoardLayout_ChessBoard(Size gridSize,int MarkerSize,
+  BoardConfiguration& TInfo,Size &imageSize,Point &origin,bool centerData,
+  vector<int> *excludedIds) throw (cv::Exception)
 {
   srand(cv::getTickCount());
 
@@ -152,9 +175,9 @@ cv::Mat  FiducidalMarkers::createBoardImage_ChessBoard( Size gridSize,int Marker
   //find the center so that the ref systeem is in it
   int centerX=sizeX/2;
   int centerY=sizeY/2;
+  imageSize=Size(sizeX,sizeY);
+  origin=centerData?Point(centerX,centerY):Point(0,0);
 
-  Mat tableImage(sizeY,sizeX,CV_8UC1);
-  tableImage.setTo(Scalar(255));
   TInfo.mInfoType=BoardConfiguration::PIX;
   unsigned int CurMarkerIdx=0;
   for (int y=0; y<gridSize.height; y++)
@@ -172,8 +195,6 @@ cv::Mat  FiducidalMarkers::createBoardImage_ChessBoard( Size gridSize,int Marker
           throw cv::Exception(999," FiducidalMarkers::createBoardImage_ChessBoard","INTERNAL ERROR. REWRITE THIS!!",__FILE__,__LINE__);
         TInfo.push_back( MarkerInfo(idsVector[CurMarkerIdx++]));
 
-        Mat subrect(tableImage,Rect( x*MarkerSize,y*MarkerSize,MarkerSize,MarkerSize));
-        Mat marker=createMarkerImage( TInfo.back().id,MarkerSize);
         //set the location of the corners
         TInfo.back().resize(4);
         TInfo.back()[0]=cv::Point3f( x*(MarkerSize),y*(MarkerSize),0);
@@ -185,12 +206,9 @@ cv::Mat  FiducidalMarkers::createBoardImage_ChessBoard( Size gridSize,int Marker
           for (int i=0; i<4; i++)
             TInfo.back()[i]-=cv::Point3f(centerX,centerY,0);
         }
-        marker.copyTo(subrect);
       }
     }
   }
-
-  return tableImage;
 }
 
 /*!
@@ -198,6 +216,20 @@ cv::Mat  FiducidalMarkers::createBoardImage_ChessBoard( Size gridSize,int Marker
  */
 cv::Mat FiducidalMarkers::createBoardImage_Frame(Size gridSize,int MarkerSize,int dist,
   BoardConfiguration& TInfo ,bool centerData,vector<int> *excludedIds ) throw (cv::Exception)
+{
+  Size imageSize;
+  Point origin;
+  createBoardLayout_Frame(gridSize,MarkerSize,dist,TInfo,imageSize,origin,centerData,
+    excludedIds);
+  return BoardRenderer(TInfo,imageSize,origin).render();
+}
+
+/*!
+ *  
+ */
+void FiducidalMarkers::createBoardLayout_Frame(Size gridSize,int MarkerSize,int dist,
+  BoardConfiguration& TInfo,Size &imageSize,Point &origin,bool centerData,
+  vector<int> *excludedIds) throw (cv::Exception)
 {
   srand(cv::getTickCount());
   int nMarkers=2*gridSize.height*2*gridSize.width;
@@ -208,9 +240,9 @@ cv::Mat FiducidalMarkers::createBoardImage_Frame(Size gridSize,int MarkerSize,in
   //find the center so that the ref systeem is in it
   int centerX=sizeX/2;
   int centerY=sizeY/2;
+  imageSize=Size(sizeX,sizeY);
+  origin=centerData?Point(centerX,centerY):Point(0,0);
 
-  Mat tableImage(sizeY,sizeX,CV_8UC1);
-  tableImage.setTo(Scalar(255));
   TInfo.mInfoType=BoardConfiguration::PIX;
   int CurMarkerIdx=0;
   int mSize=MarkerSize+dist;
@@ -221,9 +253,6 @@ cv::Mat FiducidalMarkers::createBoardImage_Frame(Size gridSize,int MarkerSize,in
       if (y==0 || y==gridSize.height-1 || x==0 ||  x==gridSize.width-1)
       {
         TInfo.push_back(  MarkerInfo(idsVector[CurMarkerIdx++]));
-        Mat subrect(tableImage,Rect( x*mSize,y*mSize,MarkerSize,MarkerSize));
-        Mat marker=createMarkerImage( TInfo.back().id,MarkerSize);
-        marker.copyTo(subrect);
         //set the location of the corners
         TInfo.back().resize(4);
         TInfo.back()[0]=cv::Point3f( x*(mSize),y*(mSize),0);
@@ -239,202 +268,15 @@ cv::Mat FiducidalMarkers::createBoardImage_Frame(Size gridSize,int MarkerSize,in
       }
     }
   }
-
-  return tableImage;
-}
-
-/*!
- *  
- */
-Mat FiducidalMarkers::rotate(const Mat  &in)
-{
-  Mat out;
-  in.copyTo(out);
-  for (int i=0; i<in.rows; i++)
-  {
-    for (int j=0; j<in.cols; j++)
-    {
-      out.at<uchar>(i,j)=in.at<uchar>(in.cols-j-1,i);
-    }
-  }
-  return out;
-}
-
-/*!
- *  
- */
-int FiducidalMarkers::hammDistMarker(Mat  bits)
-{
-  int ids[4][5]=
-  {
-    {1,0,0,0,0},
-    {1,0,1,1,1},
-    {0,1,0,0,1},
-    {0,1,1,1,0}
-  };
-  int dist=0;
-
-  for (int y=0; y<5; y++)
-  {
-    int minSum=1e5;
-    //hamming distance to each possible word
-    for (int p=0; p<4; p++)
-    {
-      int sum=0;
-      //now, count
-      for (int x=0; x<5; x++)
-        sum+=  bits.at<uchar>(y,x) == ids[p][x]?0:1;
-      if (minSum>sum) minSum=sum;
-    }
-    //do the and
-    dist+=minSum;
-  }
-  return dist;
-}
-
-/*!
- *  
- */
-int FiducidalMarkers::analyzeMarkerImage(Mat &grey,int &nRotations)
-{
-
-  //Markers  are divided in 7x7 regions, of which the inner 5x5 belongs to marker info
-  //the external border shoould be entirely black
-
-  int swidth=grey.rows/7;
-  for (int y=0; y<7; y++)
-  {
-    int inc=6;
-    if (y==0 || y==6) inc=1;//for first and last row, check the whole border
-    for (int x=0; x<7; x+=inc)
-    {
-      int Xstart=(x)*(swidth);
-      int Ystart=(y)*(swidth);
-      Mat square=grey(Rect(Xstart,Ystart,swidth,swidth));
-      int nZ=countNonZero(square);
-      if (nZ> (swidth*swidth) /2)
-      {
-//    cout<<"neb"<<endl;
-        return -1;//can not be a marker because the border element is not black!
-      }
-    }
-  }
-
-  //now,
-  vector<int> markerInfo(5);
-  Mat _bits=Mat::zeros(5,5,CV_8UC1);
-  //get information(for each inner square, determine if it is  black or white)
-
-  for (int y=0; y<5; y++)
-  {
-
-    for (int x=0; x<5; x++)
-    {
-      int Xstart=(x+1)*(swidth);
-      int Ystart=(y+1)*(swidth);
-      Mat square=grey(Rect(Xstart,Ystart,swidth,swidth));
-      int nZ=countNonZero(square);
-      if (nZ> (swidth*swidth) /2)  _bits.at<uchar>( y,x)=1;
-    }
-  }
-//    printMat<uchar>( _bits,"or mat");
-
-  //checkl all possible rotations
-  Mat _bitsFlip;
-  Mat Rotations[4];
-  Rotations[0]=_bits;
-  int dists[4];
-  dists[0]=hammDistMarker( Rotations[0]) ;
-  pair<int,int> minDist( dists[0],0);
-  for (int i=1; i<4; i++)
-  {
-    //rotate
-    Rotations[i]=rotate(Rotations[i-1]);
-    //get the hamming distance to the nearest possible word
-    dists[i]=hammDistMarker( Rotations[i]) ;
-    if (dists[i]<minDist.first)
-    {
-      minDist.first=  dists[i];
-      minDist.second=i;
-    }
-  }
-//            printMat<uchar>( Rotations [ minDist.second]);
-//      cout<<"MinDist="<<minDist.first<<" "<<minDist.second<<endl;
-
-  nRotations=minDist.second;
-  if (minDist.first!=0)  //FUTURE WORK: correct if any error
-    return -1;
-  else  //Get id of the marker
-  {
-    int MatID=0;
-    cv::Mat bits=Rotations [ minDist.second];
-    for (int y=0; y<5; y++)
-    {
-      MatID<<=1;
-      if ( bits.at<uchar>(y,1)) MatID|=1;
-      MatID<<=1;
-      if ( bits.at<uchar>(y,3)) MatID|=1;
-    }
-    return MatID;
-  }
 }
 
-/*!
- *  
- */
-//bool FiducidalMarkers::correctHammMarker(Mat &bits)
-//{
-  ////detect this lines with errors
-  //bool errors[4];
-  //int ids[4][5]=
-  //{
-    //{0,0,0,0,0},
-    //{0,0,1,1,1},
-    //{1,1,0,0,1},
-    //{1,1,1,1,0}
-  //};
-//
-  //for (int y=0; y<5; y++)
-  //{
-    //int minSum=1e5;
-    ////hamming distance to each possible word
-    //for (int p=0; p<4; p++)
-    //{
-      ////int sum=0;
-      ////now, count
-      //for (int x=0; x<5; x++)
-        //sum+=  bits.at<uchar>(y,x) == ids[p][x]?0:1;
-      //if (minSum>sum) minSum=sum;
-    //}
-    //if (minSum!=0) errors[y]=true;
-    //else errors[y]=false;
-  //}
-//
-  //return true;
-//}
-
 /*!
  *  
  */
 int FiducidalMarkers::detect(const Mat &in,int &nRotations)
 {
-  assert(in.rows==in.cols);
-  Mat grey;
-  if ( in.type()==CV_8UC1) grey=in;
-  else cv::cvtColor(in,grey,CV_BGR2GRAY);
-  //threshold image
-  threshold(grey, grey,125, 255, THRESH_BINARY|THRESH_OTSU);
-
-  //now, analyze the interior in order to get the id
-  //try first with the big ones
-
-  return analyzeMarkerImage(grey,nRotations);;
-  //too many false positives
-  /*    int id=analyzeMarkerImage(grey,nRotations);
-      if (id!=-1) return id;
-      id=analyzeMarkerImage_type2(grey,nRotations);
-      if (id!=-1) return id;
-      return -1;*/
+  //the markers of the library are one instance of the generic dictionary
+  return Dictionary::getArucoDictionary().detect(in,nRotations);
 }
 
 /*!
@@ -67,6 +67,9 @@ class ARUCO_EXPORTS FiducidalMarkers
     * Note that : The first bit, is the inverse of the hamming parity. This avoids the
     * 0 0 0 0 0 to be valid. These marker are detected by the function
     * getFiduciadlMarker_Aruco_Type1
+    *
+    * The marker is rendered in each call. Use MarkerImageCache if the same markers are required
+    * many times
     */
     static cv::Mat createMarkerImage(int id,int size) throw (cv::Exception);
 
@@ -117,14 +120,31 @@ class ARUCO_EXPORTS FiducidalMarkers
       BoardConfiguration& TInfo ,bool setDataCentered=true,vector<int> *excludedIds=NULL)
       throw (cv::Exception);
 
+    /**Creates the layout of a board as createBoardImage does, but without creating the image, so
+     * that very large boards can be rendered by bands with BoardRenderer
+     * @param imageSize output size of the image of the board
+     * @param origin output position in the image of the origin of the coordinates in TInfo
+     */
+    static void createBoardLayout(cv::Size gridSize,int MarkerSize,int dist,
+      BoardConfiguration& TInfo,cv::Size &imageSize,cv::Point &origin,
+      vector<int> *excludedIds=NULL) throw (cv::Exception);
+
+    /**Layout of createBoardImage_ChessBoard. See createBoardLayout
+     */
+    static void createBoardLayout_ChessBoard(cv::Size gridSize,int MarkerSize,
+      BoardConfiguration& TInfo,cv::Size &imageSize,cv::Point &origin,bool setDataCentered=true,
+      vector<int> *excludedIds=NULL) throw (cv::Exception);
+
+    /**Layout of createBoardImage_Frame. See createBoardLayout
+     */
+    static void createBoardLayout_Frame(cv::Size gridSize,int MarkerSize,int dist,
+      BoardConfiguration& TInfo,cv::Size &imageSize,cv::Point &origin,bool setDataCentered=true,
+      vector<int> *excludedIds=NULL) throw (cv::Exception);
+
   private:
 
     static vector<int> getListOfValidMarkersIds_random(unsigned int nMarkers,
       vector<int> *excluded) throw (cv::Exception);
-    static  cv::Mat rotate(const cv::Mat & in);
-    static  int hammDistMarker(cv::Mat  bits);
-    static  int analyzeMarkerImage(cv::Mat &grey,int &nRotations);
-    //static  bool correctHammMarker(cv::Mat &bits);
 };
 
 }
@@ -26,6 +26,7 @@ authors and should not be interpreted as representing official policies, either
 or implied, of Rafael Muñoz Salinas.
 ********************************/
 #include "board.h"
+#include "compiledboard.h"
 #include <fstream>
 using namespace std;
 using namespace cv;
@@ -63,12 +64,34 @@ BoardConfiguration & BoardConfiguration ::operator=(const BoardConfiguration  &T
 /*!
  *  
  */
-void BoardConfiguration::saveToFile ( string sfile ) throw ( cv::Exception )
+void BoardConfiguration::swap(BoardConfiguration &T)
 {
+  vector<MarkerInfo>::swap(T);
+  std::swap(mInfoType,T.mInfoType);
+}
 
-  cv::FileStorage fs ( sfile,cv::FileStorage::WRITE );
-  saveToFile(fs);
+/*!
+ *  
+ */
+void BoardConfiguration::saveToFile ( string sfile ) throw ( cv::Exception )
+{
 
+  {
+    cv::FileStorage fs ( sfile,cv::FileStorage::WRITE );
+    saveToFile(fs);
+  }
+  //the compiled form is saved too, so that the next readFromFile does not parse the file
+  try
+  {
+    MappedFile yaml;
+    yaml.open(sfile);
+    CompiledBoardConfiguration::save(*this,CompiledBoardConfiguration::getPath(sfile),
+      CompiledBoardConfiguration::checksum(yaml.data(),yaml.size()));
+  }
+  catch (cv::Exception &)
+  {
+    //it is only a cache. The directory may be read only
+  }
 }
 
 /*!
@@ -97,9 +120,33 @@ void BoardConfiguration::saveToFile(cv::FileStorage &fs)throw (cv::Exception)
  */
 void BoardConfiguration::readFromFile ( string sfile ) throw ( cv::Exception )
 {
-  cv::FileStorage fs ( sfile,cv::FileStorage::READ );
-  readFromFile(fs);
+  //the compiled form is employed if it corresponds to the current content of the file
+  uint64 sourceChecksum;
+  {
+    MappedFile yaml;
+    yaml.open(sfile);
+    sourceChecksum=CompiledBoardConfiguration::checksum(yaml.data(),yaml.size());
+  }
+  string compiledPath=CompiledBoardConfiguration::getPath(sfile);
+  CompiledBoardConfiguration compiled;
+  if (compiled.open(compiledPath,sourceChecksum))
+  {
+    compiled.copyTo(*this);
+    return;
+  }
 
+  {
+    cv::FileStorage fs ( sfile,cv::FileStorage::READ );
+    readFromFile(fs);
+  }
+  try
+  {
+    CompiledBoardConfiguration::save(*this,compiledPath,sourceChecksum);
+  }
+  catch (cv::Exception &)
+  {
+    //it is only a cache. The directory may be read only
+  }
 }
 
 
@@ -122,14 +169,15 @@ void BoardConfiguration::readFromFile(cv::FileStorage &fs)throw (cv::Exception)
   {
     at(i).id=(*it)["id"];
     FileNode FnCorners=(*it)["corners"];
+    at(i).reserve(FnCorners.size());
     for (FileNodeIterator itc = FnCorners.begin(); itc!=FnCorners.end(); ++itc)
     {
-      vector<float> coordinates3d;
-      (*itc)>>coordinates3d;
+      //the coordinates are read directly from the node, without a temporary vector
+      const FileNode &coordinates3d=*itc;
       if (coordinates3d.size()!=3)
         throw cv::Exception (81818,"BoardConfiguration::readFromFile","invalid file type 3" ,
           __FILE__,__LINE__ );
-      cv::Point3f point(coordinates3d[0],coordinates3d[1],coordinates3d[2]);
+      cv::Point3f point((float)coordinates3d[0],(float)coordinates3d[1],(float)coordinates3d[2]);
       at(i).push_back(point);
     }
   }
@@ -157,6 +205,18 @@ const MarkerInfo& BoardConfiguration::getMarkerInfo(int id)const throw (cv::Exce
     "Marker with the id given is not found",__FILE__,__LINE__);
 }
 
+/*!
+ *  
+ */
+void Board::swap ( Board &B )
+{
+  vector<Marker>::swap ( B );
+  conf.swap ( B.conf );
+  Rvec.swap ( B.Rvec );
+  Tvec.swap ( B.Tvec );
+  std::swap ( _pose,B._pose );
+}
+
 /*!
  *  
  */
@@ -175,43 +235,8 @@ void Board::glGetModelViewMatrix ( double modelview_matrix[16] ) throw ( cv::Exc
     throw cv::Exception ( 9002,"extrinsic parameters are not set","Marker::getModelViewMatrix",
       __FILE__,__LINE__ );
 
-  Mat Rot ( 3,3,CV_32FC1 ),Jacob;
-  Rodrigues ( Rvec, Rot, Jacob );
-
-  double para[3][4];
-  for ( int i=0; i<3; i++ )
-    for ( int j=0; j<3; j++ ) para[i][j]=Rot.at<float> ( i,j );
-  //now, add the translation
-  para[0][3]=Tvec.at<float> ( 0,0 );
-  para[1][3]=Tvec.at<float> ( 1,0 );
-  para[2][3]=Tvec.at<float> ( 2,0 );
-  double scale=1;
-
-  modelview_matrix[0 + 0*4] = para[0][0];
-  // R1C2
-  modelview_matrix[0 + 1*4] = para[0][1];
-  modelview_matrix[0 + 2*4] = para[0][2];
-  modelview_matrix[0 + 3*4] = para[0][3];
-  // R2
-  modelview_matrix[1 + 0*4] = para[1][0];
-  modelview_matrix[1 + 1*4] = para[1][1];
-  modelview_matrix[1 + 2*4] = para[1][2];
-  modelview_matrix[1 + 3*4] = para[1][3];
-  // R3
-  modelview_matrix[2 + 0*4] = -para[2][0];
-  modelview_matrix[2 + 1*4] = -para[2][1];
-  modelview_matrix[2 + 2*4] = -para[2][2];
-  modelview_matrix[2 + 3*4] = -para[2][3];
-  modelview_matrix[3 + 0*4] = 0.0;
-  modelview_matrix[3 + 1*4] = 0.0;
-  modelview_matrix[3 + 2*4] = 0.0;
-  modelview_matrix[3 + 3*4] = 1.0;
-  if ( scale != 0.0 )
-  {
-    modelview_matrix[12] *= scale;
-    modelview_matrix[13] *= scale;
-    modelview_matrix[14] *= scale;
-  }
+  _pose.update ( Rvec,Tvec );
+  _pose.glGetModelViewMatrix ( modelview_matrix );
 }
 
 /*!
@@ -232,81 +257,8 @@ void Board::OgreGetPoseParameters (double position[3], double orientation[4]) th
     throw cv::Exception ( 9003,"extrinsic parameters are not set",
       "Marker::getModelViewMatrix",__FILE__,__LINE__ );
 
-  // calculate position vector
-  position[0] = -Tvec.ptr<float> ( 0 ) [0];
-  position[1] = -Tvec.ptr<float> ( 0 ) [1];
-  position[2] = +Tvec.ptr<float> ( 0 ) [2];
-
-  // now calculare orientation quaternion
-  cv::Mat Rot ( 3,3,CV_32FC1 );
-  cv::Rodrigues ( Rvec, Rot );
-
-  // calculate axes for quaternion
-  double stAxes[3][3];
-  // x axis
-  stAxes[0][0] = -Rot.at<float> ( 0,0 );
-  stAxes[0][1] = -Rot.at<float> ( 1,0 );
-  stAxes[0][2] = +Rot.at<float> ( 2,0 );
-  // y axis
-  stAxes[1][0] = -Rot.at<float> ( 0,1 );
-  stAxes[1][1] = -Rot.at<float> ( 1,1 );
-  stAxes[1][2] = +Rot.at<float> ( 2,1 );
-  // for z axis, we use cross product
-  stAxes[2][0] = stAxes[0][1]*stAxes[1][2] - stAxes[0][2]*stAxes[1][1];
-  stAxes[2][1] = - stAxes[0][0]*stAxes[1][2] + stAxes[0][2]*stAxes[1][0];
-  stAxes[2][2] = stAxes[0][0]*stAxes[1][1] - stAxes[0][1]*stAxes[1][0];
-
-  // transposed matrix
-  double axes[3][3];
-  axes[0][0] = stAxes[0][0];
-  axes[1][0] = stAxes[0][1];
-  axes[2][0] = stAxes[0][2];
-
-  axes[0][1] = stAxes[1][0];
-  axes[1][1] = stAxes[1][1];
-  axes[2][1] = stAxes[1][2];
-
-  axes[0][2] = stAxes[2][0];
-  axes[1][2] = stAxes[2][1];
-  axes[2][2] = stAxes[2][2];
-
-  // Algorithm in Ken Shoemake's article in 1987 SIGGRAPH course notes
-  // article "Quaternion Calculus and Fast Animation".
-  double fTrace = axes[0][0]+axes[1][1]+axes[2][2];
-  double fRoot;
-
-  if ( fTrace > 0.0 )
-  {
-    // |w| > 1/2, may as well choose w > 1/2
-    fRoot = sqrt ( fTrace + 1.0 );  // 2w
-    orientation[0] = 0.5*fRoot;
-    fRoot = 0.5/fRoot;  // 1/(4w)
-    orientation[1] = ( axes[2][1]-axes[1][2] ) *fRoot;
-    orientation[2] = ( axes[0][2]-axes[2][0] ) *fRoot;
-    orientation[3] = ( axes[1][0]-axes[0][1] ) *fRoot;
-  }
-  else
-  {
-    // |w| <= 1/2
-    static unsigned int s_iNext[3] = { 1, 2, 0 };
-    unsigned int i = 0;
-    if ( axes[1][1] > axes[0][0] )
-      i = 1;
-    if ( axes[2][2] > axes[i][i] )
-      i = 2;
-    unsigned int j = s_iNext[i];
-    unsigned int k = s_iNext[j];
-
-    fRoot = sqrt ( axes[i][i]-axes[j][j]-axes[k][k] + 1.0 );
-    double* apkQuat[3] = { &orientation[1], &orientation[2], &orientation[3] };
-    *apkQuat[i] = 0.5*fRoot;
-    fRoot = 0.5/fRoot;
-    orientation[0] = ( axes[k][j]-axes[j][k] ) *fRoot;
-    *apkQuat[j] = ( axes[j][i]+axes[i][j] ) *fRoot;
-    *apkQuat[k] = ( axes[k][i]+axes[i][k] ) *fRoot;
-  }
-
-
+  _pose.update ( Rvec,Tvec );
+  _pose.OgreGetPoseParameters ( position,orientation );
 }
 
 /*!
@@ -348,8 +300,11 @@ void Board::readFromFile(string filePath)throw(cv::Exception)
   //look for the nmarkers
   fs["aruco_bo_nmarkers"]>>aux;
   resize ( aux );
-  fs["aruco_bo_rvec"]>> Rvec;
-  fs["aruco_bo_tvec"]>> Tvec;
+  cv::Mat rvec,tvec;
+  fs["aruco_bo_rvec"]>> rvec;
+  fs["aruco_bo_tvec"]>> tvec;
+  Rvec=rvec;
+  Tvec=tvec;
 
   cv::FileNode markers=fs["aruco_bo_markers"];
   int i=0;
@@ -30,6 +30,7 @@ or implied, of Rafael Muñoz Salinas.
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include "exports.h"
 #include "marker.h"
 using namespace std;
@@ -55,6 +56,23 @@ struct ARUCO_EXPORTS MarkerInfo:public vector<cv::Point3f>
     id=MI.id;
     return *this;
   }
+#ifdef ARUCO_HAS_MOVE
+  MarkerInfo(MarkerInfo &&MI):id(-1)
+  {
+    swap(MI);
+  }
+  MarkerInfo & operator=(MarkerInfo &&MI)
+  {
+    swap(MI);
+    return *this;
+  }
+#endif
+  ///exchanges the content with the one passed, without copying the points
+  void swap(MarkerInfo &MI)
+  {
+    vector<cv::Point3f>::swap(MI);
+    std::swap(id,MI.id);
+  }
   int id;//maker id
 };
 
@@ -108,11 +126,34 @@ class ARUCO_EXPORTS  BoardConfiguration: public vector<MarkerInfo>
     */
     BoardConfiguration & operator=(const BoardConfiguration  &T);
 
-    /*! @brief Saves the board info to a file.
+#ifdef ARUCO_HAS_MOVE
+    /*!
+    */
+    BoardConfiguration(BoardConfiguration &&T):mInfoType(NONE)
+    {
+      swap(T);
+    }
+
+    /*!
+    */
+    BoardConfiguration & operator=(BoardConfiguration &&T)
+    {
+      swap(T);
+      return *this;
+    }
+#endif
+
+    /*! @brief Exchanges the content with the one passed, without copying the markers
+    */
+    void swap(BoardConfiguration &T);
+
+    /*! @brief Saves the board info to a file, and its compiled form next to it.
     */
     void saveToFile(string sfile)throw (cv::Exception);
 
     /** @brief Reads board info from a file.
+     * The compiled form of the file (see CompiledBoardConfiguration) is employed if it is up to
+     * date. Otherwise, the file is parsed and the compiled form is saved next to it.
     */
     void readFromFile(string sfile)throw (cv::Exception);
     /**Indicates if the corners are expressed in meters
@@ -152,17 +193,12 @@ class ARUCO_EXPORTS Board:public vector<Marker>
 
   public:
     BoardConfiguration conf;
-    //matrices of rotation and translation respect to the camera
-    cv::Mat Rvec,Tvec;
-    /**
-    */
-    Board()
-    {
-      Rvec.create(3,1,CV_32FC1);
-      Tvec.create(3,1,CV_32FC1);
-      for (int i=0; i<3; i++)
-        Tvec.at<float>(i,0)=Rvec.at<float>(i,0)=-999999;
-    }
+    //matrices of rotation and translation respect to the camera (3x1 CV_32FC1, see PoseVector)
+    PoseVector Rvec,Tvec;
+
+    /**Exchanges the content with the board passed, without copying the markers
+     */
+    void swap(Board &B);
 
     /**Given the extrinsic camera parameters returns the GL_MODELVIEW matrix for opengl.
      * Setting this matrix, the reference corrdinate system will be set in this board
@@ -190,6 +226,9 @@ class ARUCO_EXPORTS Board:public vector<Marker>
     /**Read  this from a file
      */
     void readFromFile(string filePath)throw(cv::Exception);
+
+  private:
+    PoseCache _pose;//rotation matrix and quaternion of Rvec,Tvec for the GL/Ogre accessors
 };
 
 }
@@ -77,7 +77,7 @@ float  BoardDetector::detect(const cv::Mat &im)throw (cv::Exception)
   float res;
 
   if (_camParams.isValid())
-    res=detect(_vmarkers,_bconf,_boardDetected,_camParams.CameraMatrix,_camParams.Distorsion,_markerSize);
+    res=detect(_vmarkers,_bconf,_boardDetected,_camParams,_markerSize);
   else res=detect(_vmarkers,_bconf,_boardDetected);
   return res;
 }
@@ -88,7 +88,21 @@ float  BoardDetector::detect(const cv::Mat &im)throw (cv::Exception)
 float BoardDetector::detect (const vector<Marker> &detectedMarkers, const BoardConfiguration &BConf,
   Board &Bdetected,const CameraParameters &cp, float markerSizeMeters ) throw ( cv::Exception )
 {
-  return detect ( detectedMarkers, BConf,Bdetected,cp.CameraMatrix,cp.Distorsion,markerSizeMeters );
+  if (cp.DistorsionModel!=CameraParameters::FISHEYE)
+    return detect ( detectedMarkers, BConf,Bdetected,cp.CameraMatrix,cp.Distorsion,markerSizeMeters );
+
+  //OpenCV does not know the model, so the pose is calculated with the undistorted corners and
+  //then the original ones are restored in the board
+  vector<Marker> ideal ( detectedMarkers );
+  for ( size_t i=0; i<ideal.size(); i++ )
+    cp.undistortPoints ( detectedMarkers[i],ideal[i] );
+  float prob=detect ( ideal,BConf,Bdetected,cp.CameraMatrix,cp.getOpenCVDistorsion(),
+    markerSizeMeters );
+  size_t b=0;
+  for ( size_t i=0; i<detectedMarkers.size() && b<Bdetected.size(); i++ )
+    if ( BConf.getIndexOfMarkerId ( detectedMarkers[i].id ) !=-1 )
+      std::copy ( detectedMarkers[i].begin(),detectedMarkers[i].end(),Bdetected[b++].begin() );
+  return prob;
 }
 
 /*!
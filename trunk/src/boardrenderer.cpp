@@ -0,0 +1,226 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "boardrenderer.h"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+/*!
+ *  
+ */
+BoardRenderer::BoardRenderer(const BoardConfiguration &bc,cv::Size imageSize,cv::Point origin,
+  const Dictionary &dictionary) throw (cv::Exception)
+{
+  if (!bc.isExpressedInPixels())
+    throw cv::Exception(9001,"the board must be expressed in pixels","BoardRenderer::BoardRenderer",
+      __FILE__,__LINE__);
+  _imageSize=imageSize;
+  _gridSize=dictionary.getGridSize();
+  _borderWidth=dictionary.getBorderWidth();
+  _tiles.resize(bc.size());
+  for (size_t i=0; i<bc.size(); i++)
+  {
+    if (bc[i].size()!=4 || bc[i].id<0 || bc[i].id>=dictionary.size())
+      throw cv::Exception(9001,"invalid marker","BoardRenderer::BoardRenderer",__FILE__,__LINE__);
+    //the marker is the box defined by its first and third corners
+    cv::Point p0(cvRound(bc[i][0].x)+origin.x,cvRound(bc[i][0].y)+origin.y);
+    cv::Point p2(cvRound(bc[i][2].x)+origin.x,cvRound(bc[i][2].y)+origin.y);
+    _tiles[i].rect=cv::Rect(std::min(p0.x,p2.x),std::min(p0.y,p2.y),abs(p2.x-p0.x),
+      abs(p2.y-p0.y));
+    _tiles[i].code=dictionary.getCode(bc[i].id);
+  }
+  std::sort(_tiles.begin(),_tiles.end());
+}
+
+/*!
+ * Each marker is drawn as in Dictionary::createMarkerImage: cells of size/nCells pixels, black
+ * border and black remainder at the right and bottom. Cells are filled with memset
+ */
+void BoardRenderer::renderRow(int y,uchar *row,const vector<const Tile*> &tiles)const
+{
+  int nCells=_gridSize+2*_borderWidth,nBits=_gridSize*_gridSize;
+  memset(row,255,_imageSize.width);
+  for (size_t t=0; t<tiles.size(); t++)
+  {
+    const Rect &r=tiles[t]->rect;
+    if (y<r.y || y>=r.y+r.height) continue;
+    //clip to the image
+    int x0=std::max(r.x,0),x1=std::min(r.x+r.width,_imageSize.width);
+    if (x0>=x1) continue;
+    memset(row+x0,0,x1-x0);
+    int swidth=r.width/nCells;
+    if (swidth==0) continue;
+    int cy=(y-r.y)/swidth-_borderWidth;
+    if (cy<0 || cy>=_gridSize) continue;
+    for (int cx=0; cx<_gridSize; cx++)
+    {
+      if (!((tiles[t]->code>>(nBits-1-(cy*_gridSize+cx)))&1)) continue;
+      int c0=std::max(r.x+(cx+_borderWidth)*swidth,x0);
+      int c1=std::min(r.x+(cx+_borderWidth+1)*swidth,x1);
+      if (c0<c1) memset(row+c0,255,c1-c0);
+    }
+  }
+}
+
+/*!
+ *  
+ */
+void BoardRenderer::renderBand(int y0,cv::Mat &band)const throw (cv::Exception)
+{
+  if (band.type()!=CV_8UC1 || band.cols!=_imageSize.width)
+    throw cv::Exception(9001,"invalid band","BoardRenderer::renderBand",__FILE__,__LINE__);
+  int y1=y0+band.rows;
+  //markers that intersect the band. As they are sorted, the search stops at the first one
+  //below the band
+  vector<const Tile*> bandTiles;
+  for (size_t i=0; i<_tiles.size() && _tiles[i].rect.y<y1; i++)
+    if (_tiles[i].rect.y+_tiles[i].rect.height>y0) bandTiles.push_back(&_tiles[i]);
+
+  int nRows=band.rows;
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+  for (int y=0; y<nRows; y++)
+    renderRow(y0+y,band.ptr<uchar>(y),bandTiles);
+}
+
+/*!
+ *  
+ */
+cv::Mat BoardRenderer::render()const
+{
+  Mat image(_imageSize,CV_8UC1);
+  renderBand(0,image);
+  return image;
+}
+
+namespace
+{
+
+/*!
+ *  
+ */
+void writeLittleEndian(ostream &out,unsigned int value,int nBytes)
+{
+  for (int i=0; i<nBytes; i++)
+    out.put(char((value>>(8*i))&0xff));
+}
+
+/*!
+ * TIFF IFD entry of a single value
+ */
+void writeTiffEntry(ostream &out,unsigned int tag,unsigned int type,unsigned int count,
+  unsigned int value)
+{
+  writeLittleEndian(out,tag,2);
+  writeLittleEndian(out,type,2);
+  writeLittleEndian(out,count,4);
+  //SHORT values are left aligned in the 4 bytes
+  if (type==3 && count==1)
+  {
+    writeLittleEndian(out,value,2);
+    writeLittleEndian(out,0,2);
+  }
+  else writeLittleEndian(out,value,4);
+}
+
+}
+
+/*!
+ *  
+ */
+void BoardRenderer::write(const std::string &path,int bandHeight)const throw (cv::Exception)
+{
+  if (bandHeight<1)
+    throw cv::Exception(9001,"bandHeight must be >0","BoardRenderer::write",__FILE__,__LINE__);
+  string ext=path.substr(path.find_last_of('.')+1);
+  std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+  bool tiff=(ext=="tif" || ext=="tiff");
+  if (!tiff && ext!="pgm")
+    throw cv::Exception(9001,"only .tif, .tiff and .pgm files are supported",
+      "BoardRenderer::write",__FILE__,__LINE__);
+
+  ofstream out(path.c_str(),ios::binary);
+  if (!out)
+    throw cv::Exception(9001,"could not open file:"+path,"BoardRenderer::write",__FILE__,__LINE__);
+
+  int nStrips=(_imageSize.height+bandHeight-1)/bandHeight;
+  if (tiff)
+  {
+    //header, IFD, arrays of strip offsets and sizes and then the image data. The positions are
+    //calculated in 64 bits and checked, since the offsets of TIFF are 32 bits
+    const unsigned int nEntries=9;
+    uint64 width=_imageSize.width,height=_imageSize.height;
+    uint64 ifdSize=2+nEntries*12+4;
+    uint64 offsetsPos=8+ifdSize,countsPos=offsetsPos+4*uint64(nStrips);
+    uint64 dataPos=countsPos+4*uint64(nStrips);
+    uint64 stripSize=std::min(uint64(bandHeight),height)*width;
+    uint64 lastStrip=(height-uint64(nStrips-1)*bandHeight)*width;
+    if (dataPos+width*height>uint64(0xffffffff))
+      throw cv::Exception(9001,"image too big for TIFF. Use PGM","BoardRenderer::write",
+        __FILE__,__LINE__);
+    out.write("II*\0",4);
+    writeLittleEndian(out,8,4);
+    writeLittleEndian(out,nEntries,2);
+    writeTiffEntry(out,256,4,1,_imageSize.width);      //ImageWidth
+    writeTiffEntry(out,257,4,1,_imageSize.height);     //ImageLength
+    writeTiffEntry(out,258,3,1,8);                     //BitsPerSample
+    writeTiffEntry(out,259,3,1,1);                     //Compression: none
+    writeTiffEntry(out,262,3,1,1);                     //Photometric: black is zero
+    //StripOffsets and StripByteCounts point to arrays, unless there is only one strip
+    writeTiffEntry(out,273,4,nStrips,(unsigned int)(nStrips==1?dataPos:offsetsPos));
+    writeTiffEntry(out,277,3,1,1);                     //SamplesPerPixel
+    writeTiffEntry(out,278,4,1,bandHeight);            //RowsPerStrip
+    writeTiffEntry(out,279,4,nStrips,(unsigned int)(nStrips==1?lastStrip:countsPos));
+    writeLittleEndian(out,0,4);                        //no more IFDs
+    //all the offsets and sizes are below dataPos+width*height, checked above
+    for (int s=0; s<nStrips; s++)
+      writeLittleEndian(out,(unsigned int)(dataPos+uint64(s)*stripSize),4);
+    for (int s=0; s<nStrips; s++)
+      writeLittleEndian(out,(unsigned int)(s==nStrips-1?lastStrip:stripSize),4);
+  }
+  else
+    out<<"P5\n"<<_imageSize.width<<" "<<_imageSize.height<<"\n255\n";
+
+  Mat band(bandHeight,_imageSize.width,CV_8UC1);
+  for (int y0=0; y0<_imageSize.height; y0+=bandHeight)
+  {
+    int rows=std::min(bandHeight,_imageSize.height-y0);
+    Mat subBand=band.rowRange(0,rows);
+    renderBand(y0,subBand);
+    out.write((const char*)band.ptr<uchar>(0),std::streamsize(rows)*_imageSize.width);
+  }
+  if (!out)
+    throw cv::Exception(9001,"error writing file:"+path,"BoardRenderer::write",__FILE__,__LINE__);
+}
+
+}
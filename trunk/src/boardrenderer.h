@@ -0,0 +1,107 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_BoardRenderer_H
+#define _ARUCO_BoardRenderer_H
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include "exports.h"
+#include "board.h"
+#include "dictionary.h"
+namespace aruco
+{
+
+/**\brief Renders the image of a board by horizontal bands, so that boards of any size can be
+ * generated with bounded memory.
+ *
+ * The board must be expressed in pixels, with the markers aligned with the image axes, as the ones
+ * created by FiducidalMarkers::createBoardLayout*. Only the codewords of the markers are kept, and
+ * each band is rasterized row by row from them (in parallel if the library is compiled with
+ * USE_OMP). The image can be written to a file band by band with write().
+ */
+class ARUCO_EXPORTS BoardRenderer
+{
+  public:
+
+    /**
+     * @param bc board with the corners in pixels
+     * @param imageSize size of the whole image
+     * @param origin position in the image of the origin of the coordinates of bc
+     * @param dictionary dictionary of the markers of the board. A copy is not made, so it must exist
+     * while this object is employed
+     */
+    BoardRenderer(const BoardConfiguration &bc,cv::Size imageSize,cv::Point origin,
+      const Dictionary &dictionary=Dictionary::getArucoDictionary()) throw (cv::Exception);
+
+    /**
+     */
+    cv::Size getImageSize()const
+    {
+      return _imageSize;
+    }
+
+    /**Renders the rows [y0,y0+band.rows) of the image in band, that must be a CV_8UC1 image with
+     * the width of the image
+     */
+    void renderBand(int y0,cv::Mat &band)const throw (cv::Exception);
+
+    /**Renders the whole image. Only for boards that fit in memory
+     */
+    cv::Mat render()const;
+
+    /**Writes the image to a file, rendering it band by band. The format is given by the extension:
+     * .tif or .tiff (uncompressed 8 bit TIFF with a strip for each band, up to 4GB) or .pgm (binary
+     * PGM)
+     * @param path output file
+     * @param bandHeight number of rows rendered at once
+     */
+    void write(const std::string &path,int bandHeight=256)const throw (cv::Exception);
+
+  private:
+
+    struct Tile
+    {
+      cv::Rect rect;   //region of the marker in the image
+      uint64 code;     //bits of the marker
+      bool operator<(const Tile &t)const
+      {
+        return rect.y<t.rect.y;
+      }
+    };
+
+    //renders a row of the image. tiles are the ones that may intersect it
+    void renderRow(int y,uchar *row,const std::vector<const Tile*> &tiles)const;
+
+    cv::Size _imageSize;
+    int _gridSize,_borderWidth;
+    std::vector<Tile> _tiles; //sorted by rect.y
+};
+
+}
+
+#endif
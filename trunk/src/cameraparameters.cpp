@@ -26,7 +26,9 @@ authors and should not be interpreted as representing official policies, either
 or implied, of Rafael Muñoz Salinas.
 ********************************/
 #include "cameraparameters.h"
+#include <algorithm>
 #include <fstream>
+#include <cstring>
 #include <iostream>
 #include <opencv/cv.h>
 using namespace std;
@@ -39,12 +41,15 @@ CameraParameters::CameraParameters()
   CameraMatrix=cv::Mat();
   Distorsion=cv::Mat();
   CamSize=cv::Size(-1,-1);
+  DistorsionModel=RADIAL_TANGENTIAL;
+  _glProjection.valid=false;
 }
 
-CameraParameters::CameraParameters(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size)
-throw(cv::Exception)
+CameraParameters::CameraParameters(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size,
+  DistorsionModels model) throw(cv::Exception)
 {
-  setParams(cameraMatrix,distorsionCoeff,size);
+  _glProjection.valid=false;
+  setParams(cameraMatrix,distorsionCoeff,size,model);
 }
 
 CameraParameters::CameraParameters(const CameraParameters &CI)
@@ -52,6 +57,8 @@ CameraParameters::CameraParameters(const CameraParameters &CI)
   CI.CameraMatrix.copyTo(CameraMatrix);
   CI.Distorsion.copyTo(Distorsion);
   CamSize=CI.CamSize;
+  DistorsionModel=CI.DistorsionModel;
+  _glProjection=CI._glProjection;
 }
 
 CameraParameters & CameraParameters::operator=(const CameraParameters &CI)
@@ -59,29 +66,32 @@ CameraParameters & CameraParameters::operator=(const CameraParameters &CI)
   CI.CameraMatrix.copyTo(CameraMatrix);
   CI.Distorsion.copyTo(Distorsion);
   CamSize=CI.CamSize;
+  DistorsionModel=CI.DistorsionModel;
+  _glProjection=CI._glProjection;
   return *this;
 }
 
-void CameraParameters::setParams(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size)
-  throw(cv::Exception)
+void CameraParameters::setParams(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size,
+  DistorsionModels model) throw(cv::Exception)
 {
   if (cameraMatrix.rows!=3 || cameraMatrix.cols!=3)
     throw cv::Exception(9000,"invalid input cameraMatrix","CameraParameters::setParams",
       __FILE__,__LINE__);
   cameraMatrix.convertTo(CameraMatrix,CV_32FC1);
-  if (  distorsionCoeff.total()<4 ||  distorsionCoeff.total()>=7 )
+  size_t nCoeffs=distorsionCoeff.total();
+  if (nCoeffs<4 || nCoeffs>8 || (model==FISHEYE && nCoeffs!=4))
     throw cv::Exception(9000,"invalid input distorsionCoeff","CameraParameters::setParams",
       __FILE__,__LINE__);
   cv::Mat auxD;
-
-  distorsionCoeff.convertTo( Distorsion,CV_32FC1);
-
-//     Distorsion.create(1,4,CV_32FC1);
-//     for (int i=0;i<4;i++)
-//         Distorsion.ptr<float>(0)[i]=auxD.ptr<float>(0)[i];
+  distorsionCoeff.reshape(1,1).convertTo(auxD,CV_32FC1);
+  //OpenCV accepts 4, 5 or 8 coefficients, so 6 and 7 are completed with zeros
+  Distorsion=cv::Mat::zeros(1,nCoeffs>5?8:nCoeffs,CV_32FC1);
+  for (size_t i=0; i<nCoeffs; i++)
+    Distorsion.ptr<float>(0)[i]=auxD.ptr<float>(0)[i];
+  DistorsionModel=model;
 
   CamSize=size;
-
+  _glProjection.valid=false;
 }
 
 /**
@@ -115,8 +125,12 @@ void CameraParameters::readFromFile(string path)throw(cv::Exception)
     throw cv::Exception(9005,"could not open file:"+path,"CameraParameters::readFromFile",
       __FILE__,__LINE__);
 //Create the matrices
-  Distorsion=cv::Mat::zeros(4,1,CV_32FC1);
   CameraMatrix=cv::Mat::eye(3,3,CV_32FC1);
+  //k1,k2,p1,p2,k3,k4,k5,k6 and whether each one is in the file
+  float coeffs[8]={0,0,0,0,0,0,0,0};
+  bool found[8]={false,false,false,false,false,false,false,false};
+  const char *names[8]={"k1","k2","p1","p2","k3","k4","k5","k6"};
+  bool fisheye=false;
   char line[1024];
   while (!file.eof())
   {
@@ -130,14 +144,36 @@ void CameraParameters::readFromFile(string path)throw(cv::Exception)
       else if (scmd=="cx") CameraMatrix.at<float>(0,2)=fval;
       else if (scmd=="fy") CameraMatrix.at<float>(1,1)=fval;
       else if (scmd=="cy") CameraMatrix.at<float>(1,2)=fval;
-      else if (scmd=="k1") Distorsion.at<float>(0,0)=fval;
-      else if (scmd=="k2") Distorsion.at<float>(1,0)=fval;
-      else if (scmd=="p1") Distorsion.at<float>(2,0)=fval;
-      else if (scmd=="p2") Distorsion.at<float>(3,0)=fval;
       else if (scmd=="width") CamSize.width=fval;
       else if (scmd=="height") CamSize.height=fval;
+      else if (scmd=="fisheye") fisheye=fval!=0;
+      else
+        for (int i=0; i<8; i++)
+          if (scmd==names[i])
+          {
+            coeffs[i]=fval;
+            found[i]=true;
+          }
     }
   }
+  if (fisheye)
+  {
+    //k1,k2,k3,k4 of the fisheye model
+    DistorsionModel=FISHEYE;
+    Distorsion.create(4,1,CV_32FC1);
+    Distorsion.at<float>(0,0)=coeffs[0];
+    Distorsion.at<float>(1,0)=coeffs[1];
+    Distorsion.at<float>(2,0)=coeffs[4];
+    Distorsion.at<float>(3,0)=coeffs[5];
+  }
+  else
+  {
+    DistorsionModel=RADIAL_TANGENTIAL;
+    int n=(found[5]||found[6]||found[7])?8:(found[4]?5:4);
+    Distorsion.create(n,1,CV_32FC1);
+    for (int i=0; i<n; i++) Distorsion.at<float>(i,0)=coeffs[i];
+  }
+  _glProjection.valid=false;
 }
 
 void CameraParameters::saveToFile(string path,bool inXML)throw(cv::Exception)
@@ -155,10 +191,25 @@ void CameraParameters::saveToFile(string path,bool inXML)throw(cv::Exception)
     file<<"cx = "<<CameraMatrix.at<float>(0,2)<<endl;
     file<<"fy = "<<CameraMatrix.at<float>(1,1)<<endl;
     file<<"cy = "<<CameraMatrix.at<float>(1,2)<<endl;
-    file<<"k1 = "<<Distorsion.at<float>(0,0)<<endl;
-    file<<"k2 = "<<Distorsion.at<float>(1,0)<<endl;
-    file<<"p1 = "<<Distorsion.at<float>(2,0)<<endl;
-    file<<"p2 = "<<Distorsion.at<float>(3,0)<<endl;
+    const float *d=Distorsion.ptr<float>(0);
+    if (DistorsionModel==FISHEYE)
+    {
+      file<<"fisheye = 1"<<endl;
+      file<<"k1 = "<<d[0]<<endl;
+      file<<"k2 = "<<d[1]<<endl;
+      file<<"k3 = "<<d[2]<<endl;
+      file<<"k4 = "<<d[3]<<endl;
+    }
+    else
+    {
+      file<<"k1 = "<<d[0]<<endl;
+      file<<"k2 = "<<d[1]<<endl;
+      file<<"p1 = "<<d[2]<<endl;
+      file<<"p2 = "<<d[3]<<endl;
+      const char *names[4]={"k3","k4","k5","k6"};
+      for (size_t i=4; i<Distorsion.total(); i++)
+        file<<names[i-4]<<" = "<<d[i]<<endl;
+    }
     file<<"width = "<<CamSize.width<<endl;
     file<<"height = "<<CamSize.height<<endl;
   }
@@ -169,6 +220,8 @@ void CameraParameters::saveToFile(string path,bool inXML)throw(cv::Exception)
     fs<<"image_height" << CamSize.height;
     fs<<"camera_matrix" << CameraMatrix;
     fs<<"distortion_coefficients" <<Distorsion;
+    if (DistorsionModel==FISHEYE)
+      fs<<"distortion_model"<<"fisheye";
   }
 }
 
@@ -186,6 +239,7 @@ void CameraParameters::resize(cv::Size size)throw(cv::Exception)
   CameraMatrix.at<float>(0,2)*=AxFactor;
   CameraMatrix.at<float>(1,1)*=AyFactor;
   CameraMatrix.at<float>(1,2)*=AyFactor;
+  _glProjection.valid=false;
 }
 
 void CameraParameters::readFromXMLFile(string filePath)throw(cv::Exception)
@@ -216,24 +270,30 @@ void CameraParameters::readFromXMLFile(string filePath)throw(cv::Exception)
     throw cv::Exception(9007,"File :"+filePath+" does not contains valid distortion_coefficients",
       "CameraParameters::readFromXML",__FILE__,__LINE__);
 
-  //convert to 32 and get the 4 first elements only
+  string model;
+  if (fs["distortion_model"].name()=="distortion_model")
+    fs["distortion_model"]>>model;
+  DistorsionModel=(model=="fisheye" || model=="equidistant")?FISHEYE:RADIAL_TANGENTIAL;
+
+  //convert to 32 and get the elements of the model (the thin prism and tilt coefficients
+  //of OpenCV 3 are not supported). As in setParams, 6 and 7 coefficients are completed with zeros
   cv::Mat mdist32;
   MDist.convertTo(mdist32,CV_32FC1);
-  Distorsion.create(1,4,CV_32FC1);
-  for (int i=0; i<4; i++)
+  int n=4;
+  if (DistorsionModel==RADIAL_TANGENTIAL)
+    n=std::min(int(MDist.total()),8);
+  Distorsion=cv::Mat::zeros(1,n>5?8:n,CV_32FC1);
+  for (int i=0; i<n; i++)
     Distorsion.ptr<float>(0)[i]=mdist32.ptr<float>(0)[i];
 
   CamSize.width=w;
   CamSize.height=h;
+  _glProjection.valid=false;
 }
 
 void CameraParameters::glGetProjectionMatrix(cv::Size orgImgSize, cv::Size size,
   double proj_matrix[16], double gnear, double gfar, bool invert) throw(cv::Exception)
 {
-  if (cv::countNonZero(Distorsion)!=0)
-    std::cerr<< "CameraParameters::glGetProjectionMatrix - The camera has distortion coefficients "
-      <<__FILE__<<" "<<__LINE__<<endl;
-
   if (isValid()==false)
     throw cv::Exception(9100,"invalid camera parameters","CameraParameters::glGetProjectionMatrix",
       __FILE__,__LINE__);
@@ -241,10 +301,28 @@ void CameraParameters::glGetProjectionMatrix(cv::Size orgImgSize, cv::Size size,
   //Deterime the rsized info
   double Ax=double(size.width)/double(orgImgSize.width);
   double Ay=double(size.height)/double(orgImgSize.height);
-  double _fx=CameraMatrix.at<float>(0,0)*Ax;
-  double _cx=CameraMatrix.at<float>(0,2)*Ax;
-  double _fy=CameraMatrix.at<float>(1,1)*Ay;
-  double _cy=CameraMatrix.at<float>(1,2)*Ay;
+  double intrinsics[4]={CameraMatrix.at<float>(0,0),CameraMatrix.at<float>(0,2),
+                        CameraMatrix.at<float>(1,1),CameraMatrix.at<float>(1,2)};
+
+  //same request as the last time?
+  GLProjectionCache &cache=_glProjection;
+  if (cache.valid && cache.orgImgSize==orgImgSize && cache.size==size && cache.gnear==gnear &&
+      cache.gfar==gfar && cache.invert==invert && cache.intrinsics[0]==intrinsics[0] &&
+      cache.intrinsics[1]==intrinsics[1] && cache.intrinsics[2]==intrinsics[2] &&
+      cache.intrinsics[3]==intrinsics[3])
+  {
+    memcpy(proj_matrix,cache.matrix,16*sizeof(double));
+    return;
+  }
+
+  if (cv::countNonZero(Distorsion)!=0)
+    std::cerr<< "CameraParameters::glGetProjectionMatrix - The camera has distortion coefficients "
+      <<__FILE__<<" "<<__LINE__<<endl;
+
+  double _fx=intrinsics[0]*Ax;
+  double _cx=intrinsics[1]*Ax;
+  double _fy=intrinsics[2]*Ay;
+  double _cy=intrinsics[3]*Ay;
   double cparam[3][4] =
   {
     {_fx,   0,  _cx, 0},
@@ -252,7 +330,148 @@ void CameraParameters::glGetProjectionMatrix(cv::Size orgImgSize, cv::Size size,
     {0,     0,    1, 0}
   };
 
-  argConvGLcpara2( cparam, size.width, size.height, gnear, gfar, proj_matrix, invert );
+  cache.valid=false;
+  argConvGLcpara2( cparam, size.width, size.height, gnear, gfar, cache.matrix, invert );
+  cache.orgImgSize=orgImgSize;
+  cache.size=size;
+  cache.gnear=gnear;
+  cache.gfar=gfar;
+  cache.invert=invert;
+  for (int i=0; i<4; i++) cache.intrinsics[i]=intrinsics[i];
+  cache.valid=true;
+  memcpy(proj_matrix,cache.matrix,16*sizeof(double));
+}
+
+void CameraParameters::getCoefficients(double k[8])const
+{
+  for (int i=0; i<8; i++) k[i]=0;
+  const float *d=Distorsion.ptr<float>(0);
+  for (size_t i=0; i<Distorsion.total() && i<8; i++) k[i]=d[i];
+}
+
+/*
+ * The routines below process the points in plain loops over the arrays, with a fixed number of
+ * iterations for the iterative inversions, instead of calling cv::undistortPoints and
+ * cv::fisheye per point. They use sqrt, tan, atan and divisions, so they are not vectorized
+ */
+void CameraParameters::undistortPoints(const vector<cv::Point2f> &in,vector<cv::Point2f> &out)
+  const throw(cv::Exception)
+{
+  if (!isValid())
+    throw cv::Exception(9100,"invalid camera parameters","CameraParameters::undistortPoints",
+      __FILE__,__LINE__);
+  out.resize(in.size());
+  if (in.empty()) return;
+  double fx=CameraMatrix.at<float>(0,0),cx=CameraMatrix.at<float>(0,2);
+  double fy=CameraMatrix.at<float>(1,1),cy=CameraMatrix.at<float>(1,2);
+  double k[8];
+  getCoefficients(k);
+  const cv::Point2f *src=&in[0];
+  cv::Point2f *dst=&out[0];
+  int n=in.size();
+
+  if (DistorsionModel==FISHEYE)
+  {
+    for (int i=0; i<n; i++)
+    {
+      double xd=(src[i].x-cx)/fx,yd=(src[i].y-cy)/fy;
+      double thetad=sqrt(xd*xd+yd*yd);
+      //solve thetad=theta*(1+k1*theta^2+k2*theta^4+k3*theta^6+k4*theta^8) with Newton
+      double theta=thetad;
+      for (int it=0; it<10; it++)
+      {
+        double t2=theta*theta,t4=t2*t2,t6=t4*t2,t8=t4*t4;
+        double f=theta*(1+k[0]*t2+k[1]*t4+k[2]*t6+k[3]*t8)-thetad;
+        double df=1+3*k[0]*t2+5*k[1]*t4+7*k[2]*t6+9*k[3]*t8;
+        theta-=f/df;
+      }
+      double scale=thetad>1e-8?tan(theta)/thetad:1.;
+      dst[i].x=xd*scale*fx+cx;
+      dst[i].y=yd*scale*fy+cy;
+    }
+  }
+  else
+  {
+    for (int i=0; i<n; i++)
+    {
+      double x0=(src[i].x-cx)/fx,y0=(src[i].y-cy)/fy;
+      double x=x0,y=y0;
+      //fixed point iteration, as cv::undistortPoints, with more iterations for wide angles
+      for (int it=0; it<10; it++)
+      {
+        double r2=x*x+y*y,r4=r2*r2,r6=r4*r2;
+        double icdist=(1+k[5]*r2+k[6]*r4+k[7]*r6)/(1+k[0]*r2+k[1]*r4+k[4]*r6);
+        double dx=2*k[2]*x*y+k[3]*(r2+2*x*x);
+        double dy=k[2]*(r2+2*y*y)+2*k[3]*x*y;
+        x=(x0-dx)*icdist;
+        y=(y0-dy)*icdist;
+      }
+      dst[i].x=x*fx+cx;
+      dst[i].y=y*fy+cy;
+    }
+  }
+}
+
+void CameraParameters::distortPoints(const vector<cv::Point2f> &in,vector<cv::Point2f> &out)
+  const throw(cv::Exception)
+{
+  if (!isValid())
+    throw cv::Exception(9100,"invalid camera parameters","CameraParameters::distortPoints",
+      __FILE__,__LINE__);
+  out.resize(in.size());
+  if (in.empty()) return;
+  double fx=CameraMatrix.at<float>(0,0),cx=CameraMatrix.at<float>(0,2);
+  double fy=CameraMatrix.at<float>(1,1),cy=CameraMatrix.at<float>(1,2);
+  double k[8];
+  getCoefficients(k);
+  const cv::Point2f *src=&in[0];
+  cv::Point2f *dst=&out[0];
+  int n=in.size();
+
+  if (DistorsionModel==FISHEYE)
+  {
+    for (int i=0; i<n; i++)
+    {
+      double x=(src[i].x-cx)/fx,y=(src[i].y-cy)/fy;
+      double r=sqrt(x*x+y*y);
+      double theta=atan(r);
+      double t2=theta*theta,t4=t2*t2,t6=t4*t2,t8=t4*t4;
+      double thetad=theta*(1+k[0]*t2+k[1]*t4+k[2]*t6+k[3]*t8);
+      double scale=r>1e-8?thetad/r:1.;
+      dst[i].x=x*scale*fx+cx;
+      dst[i].y=y*scale*fy+cy;
+    }
+  }
+  else
+  {
+    for (int i=0; i<n; i++)
+    {
+      double x=(src[i].x-cx)/fx,y=(src[i].y-cy)/fy;
+      double r2=x*x+y*y,r4=r2*r2,r6=r4*r2;
+      double radial=(1+k[0]*r2+k[1]*r4+k[4]*r6)/(1+k[5]*r2+k[6]*r4+k[7]*r6);
+      double xd=x*radial+2*k[2]*x*y+k[3]*(r2+2*x*x);
+      double yd=y*radial+k[2]*(r2+2*y*y)+2*k[3]*x*y;
+      dst[i].x=xd*fx+cx;
+      dst[i].y=yd*fy+cy;
+    }
+  }
+}
+
+void CameraParameters::projectPoints(const cv::Mat &objectPoints,const cv::Mat &Rvec,
+  const cv::Mat &Tvec,vector<cv::Point2f> &imagePoints)const throw(cv::Exception)
+{
+  if (!isValid())
+    throw cv::Exception(9100,"invalid camera parameters","CameraParameters::projectPoints",
+      __FILE__,__LINE__);
+  if (DistorsionModel!=FISHEYE)
+  {
+    cv::projectPoints(objectPoints,Rvec,Tvec,CameraMatrix,Distorsion,imagePoints);
+    return;
+  }
+  //ideal projection, and then the fisheye distortion
+  cv::projectPoints(objectPoints,Rvec,Tvec,CameraMatrix,cv::Mat::zeros(1,4,CV_32FC1),
+    imagePoints);
+  distortPoints(imagePoints,imagePoints);
 }
 
 double CameraParameters::norm( double a, double b, double c )
@@ -30,6 +30,7 @@ or implied, of Rafael Muñoz Salinas.
 #include "exports.h"
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <vector>
 using namespace std;
 namespace aruco
 {
@@ -40,9 +41,16 @@ class ARUCO_EXPORTS  CameraParameters
 {
   public:
 
+    /**Distortion models. RADIAL_TANGENTIAL is the model of OpenCV, with 4 (k1,k2,p1,p2),
+     * 5 (k1,k2,p1,p2,k3) or 8 (k1,k2,p1,p2,k3,k4,k5,k6, rational) coefficients. FISHEYE is the
+     * equidistant model (k1,k2,k3,k4) of wide angle lenses
+     */
+    enum DistorsionModels {RADIAL_TANGENTIAL,FISHEYE};
+
     cv::Mat  CameraMatrix;  ///<  3x3 matrix (fx 0 cx, 0 fy cy, 0 0 1)
-    cv::Mat  Distorsion;    ///< 4x1 matrix (k1,k2,p1,p2)
+    cv::Mat  Distorsion;    ///< 4, 5 or 8 coefficients (see DistorsionModels)
     cv::Size CamSize;       ///< size of the image
+    DistorsionModels DistorsionModel; ///< model of the coefficients in Distorsion
 
     /**Empty constructor
      */
@@ -50,19 +58,21 @@ class ARUCO_EXPORTS  CameraParameters
 
     /**Creates the object from the info passed
      * @param cameraMatrix 3x3 matrix (fx 0 cx, 0 fy cy, 0 0 1)
-     * @param distorsionCoeff 4x1 matrix (k1,k2,p1,p2)
+     * @param distorsionCoeff 4, 5 or 8 coefficients (4 if model is FISHEYE)
      * @param size image size
+     * @param model model of the distortion coefficients
      */
-    CameraParameters(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size)
-      throw(cv::Exception);
+    CameraParameters(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size,
+      DistorsionModels model=RADIAL_TANGENTIAL) throw(cv::Exception);
 
     /**Sets the parameters
      * @param cameraMatrix 3x3 matrix (fx 0 cx, 0 fy cy, 0 0 1)
-     * @param distorsionCoeff 4x1 matrix (k1,k2,p1,p2)
+     * @param distorsionCoeff 4, 5 or 8 coefficients (4 if model is FISHEYE)
      * @param size image size
+     * @param model model of the distortion coefficients
      */
-    void setParams(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size)
-      throw(cv::Exception);
+    void setParams(cv::Mat cameraMatrix,cv::Mat distorsionCoeff,cv::Size size,
+      DistorsionModels model=RADIAL_TANGENTIAL) throw(cv::Exception);
 
     /**Copy constructor
      */
@@ -88,7 +98,9 @@ class ARUCO_EXPORTS  CameraParameters
      */
     void saveToFile(string path,bool inXML=true)throw(cv::Exception);
 
-    /**Reads from a YAML file generated with the opencv2.2 calibration utility
+    /**Reads from a YAML file generated with the opencv2.2 calibration utility. Up to 8
+     * distortion coefficients are kept. The optional node distortion_model set to "fisheye" or
+     * "equidistant" indicates the FISHEYE model
      */
     void readFromXMLFile(string filePath)throw(cv::Exception);
 
@@ -101,6 +113,37 @@ class ARUCO_EXPORTS  CameraParameters
      */
     static cv::Point3f getCameraLocation(cv::Mat Rvec,cv::Mat Tvec);
 
+    /**Removes the distortion of the points passed, that are returned in the pixel coordinates
+     * of an ideal camera with the same CameraMatrix and no distortion. in and out can be the
+     * same vector. Only the points are processed, so it is much cheaper than undistorting the
+     * image when just the corners are required
+     */
+    void undistortPoints(const std::vector<cv::Point2f> &in,std::vector<cv::Point2f> &out)const
+      throw(cv::Exception);
+
+    /**Inverse of undistortPoints: applies the distortion to points expressed in the pixel
+     * coordinates of the ideal camera. in and out can be the same vector
+     */
+    void distortPoints(const std::vector<cv::Point2f> &in,std::vector<cv::Point2f> &out)const
+      throw(cv::Exception);
+
+    /**As cv::projectPoints, but with the distortion model of this object
+     * @param objectPoints Nx3 CV_32FC1 or Nx1 CV_32FC3 matrix
+     * @param Rvec,Tvec pose of the points respect to the camera
+     * @param imagePoints output projections
+     */
+    void projectPoints(const cv::Mat &objectPoints,const cv::Mat &Rvec,const cv::Mat &Tvec,
+      std::vector<cv::Point2f> &imagePoints)const throw(cv::Exception);
+
+    /**Returns the coefficients to pass to the OpenCV functions (projectPoints, solvePnP...)
+     * along with the image points. For the FISHEYE model, that OpenCV does not know, they are
+     * zeros and the points must be undistorted first with undistortPoints
+     */
+    cv::Mat getOpenCVDistorsion()const
+    {
+      return DistorsionModel==FISHEYE?cv::Mat::zeros(1,4,CV_32FC1):Distorsion;
+    }
+
     /**Given the intrinsic camera parameters returns the GL_PROJECTION matrix for opengl.
     * PLease NOTE that when using OpenGL, it is assumed no camera distorsion! So, if it is not true,
     * you should have undistor image
@@ -112,6 +155,9 @@ class ARUCO_EXPORTS  CameraParameters
     * @param gnear,gfar: visible rendering range
     * @param invert: indicates if the output projection matrix has to yield a horizontally inverted
     * image because image data has not been stored in the order of glDrawPixels: bottom-to-top.
+    *
+    * The last matrix computed is cached, so calling this every frame with the same arguments only
+    * copies 16 values. The cache is dropped whenever the parameters change.
     */
     void glGetProjectionMatrix( cv::Size orgImgSize, cv::Size size,double proj_matrix[16],
       double gnear,double gfar,bool invert=false   )throw(cv::Exception);
@@ -131,6 +177,21 @@ class ARUCO_EXPORTS  CameraParameters
 
 
   private:
+    //last matrix returned by glGetProjectionMatrix and the inputs it was computed from
+    struct GLProjectionCache
+    {
+      bool valid;
+      cv::Size orgImgSize,size;
+      double gnear,gfar;
+      bool invert;
+      double intrinsics[4];///< fx,cx,fy,cy of CameraMatrix, to notice direct writes to it
+      double matrix[16];
+    };
+    GLProjectionCache _glProjection;
+
+    //coefficients of the model as doubles (unused ones set to 0)
+    void getCoefficients(double k[8])const;
+
     //GL routines
     static void argConvGLcpara2(double cparam[3][4], int width, int height, double gnear,
       double gfar, double m[16], bool invert )throw(cv::Exception);
@@ -0,0 +1,146 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "codebookoptimizer.h"
+#include <limits>
+using namespace std;
+namespace aruco
+{
+
+/*!
+ *  
+ */
+CodebookOptimizer::CodebookOptimizer(const Dictionary &dictionary):_dict(dictionary)
+{
+}
+
+/*!
+ *  
+ */
+int CodebookOptimizer::distance(int id1,int id2)const
+{
+  uint64 code2=_dict.getCode(id2);
+  int minDist=Dictionary::popCount(_dict.getCode(id1)^code2);
+  for (int r=1; r<4; r++)
+    minDist=std::min(minDist,Dictionary::popCount(_dict.getCode(id1,r)^code2));
+  return minDist;
+}
+
+/*!
+ *  
+ */
+int CodebookOptimizer::getMinDistance(const std::vector<int> &ids)const
+{
+  int minDist=std::numeric_limits<int>::max();
+  for (size_t i=0; i+1<ids.size(); i++)
+    for (size_t j=i+1; j<ids.size(); j++)
+      minDist=std::min(minDist,distance(ids[i],ids[j]));
+  return minDist;
+}
+
+/*!
+ *  
+ */
+int CodebookOptimizer::entropy(int id)const
+{
+  int n=_dict.getGridSize(),nBits=n*n;
+  uint64 code=_dict.getCode(id);
+  int totalEntropy=0;
+  for (int y=0; y<n; y++)
+    for (int x=0; x<n; x++)
+    {
+      int bit=(code>>(nBits-1-(y*n+x)))&1;
+      for (int yy=std::max(y-1,0); yy<std::min(y+1,n); yy++)
+        for (int xx=std::max(x-1,0); xx<std::min(x+1,n); xx++)
+          if (bit!=int((code>>(nBits-1-(yy*n+xx)))&1)) totalEntropy++;
+    }
+  return totalEntropy;
+}
+
+/*!
+ *  
+ */
+std::vector<int> CodebookOptimizer::select(int nMarkers,int minEntropy,int minDistance)const
+  throw (cv::Exception)
+{
+  int n=_dict.size();
+  if (nMarkers<1 || nMarkers>n)
+    throw cv::Exception(9005,"invalid number of markers","CodebookOptimizer::select",
+      __FILE__,__LINE__);
+
+  //distance of each marker to the nearest selected one. -1 for the ones that can not be selected
+  vector<int> minDist(n);
+  int first=0,bestEntropy=-1;
+  for (int i=0; i<n; i++)
+  {
+    int e=entropy(i);
+    minDist[i]=e<minEntropy?-1:std::numeric_limits<int>::max();
+    if (e>bestEntropy)
+    {
+      bestEntropy=e;
+      first=i;
+    }
+  }
+
+  vector<int> selected;
+  int added=first;
+  while (true)
+  {
+    selected.push_back(added);
+    minDist[added]=-1;
+    if (int(selected.size())==nMarkers) break;
+
+    //update the distances with the marker added. Its rotations are loaded only once
+    uint64 rots[4];
+    for (int r=0; r<4; r++) rots[r]=_dict.getCode(added,r);
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+    for (int j=0; j<n; j++)
+    {
+      if (minDist[j]<0) continue;
+      uint64 code=_dict.getCode(j);
+      int d=Dictionary::popCount(rots[0]^code);
+      for (int r=1; r<4; r++) d=std::min(d,Dictionary::popCount(rots[r]^code));
+      if (d<minDist[j]) minDist[j]=d;
+    }
+
+    //the farthest one is the next
+    added=-1;
+    int farthest=minDistance-1;
+    for (int j=0; j<n; j++)
+      if (minDist[j]>farthest)
+      {
+        farthest=minDist[j];
+        added=j;
+      }
+    if (added==-1) break;
+  }
+  return selected;
+}
+
+}
@@ -0,0 +1,92 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_CodebookOptimizer_H
+#define _ARUCO_CodebookOptimizer_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "exports.h"
+#include "dictionary.h"
+namespace aruco
+{
+
+/**\brief Selects subsets of markers of a dictionary that are as far as possible from each other.
+ *
+ * The distance between two markers is the minimum hamming distance between the first one and the
+ * rotations of the second one. The codewords and their rotations are taken packed from the
+ * dictionary and compared by means of xor and popcount.
+ *
+ * The selection is greedy: each new marker is the one whose distance to the nearest marker already
+ * selected is maximum. Instead of a matrix with all the distances, the distance of each candidate
+ * to the selected set is kept and updated when a marker is added, so the memory is linear in the
+ * size of the dictionary and very large dictionaries can be employed. Updates are done in parallel
+ * if the library is compiled with USE_OMP.
+ */
+class ARUCO_EXPORTS CodebookOptimizer
+{
+  public:
+
+    /**
+     * @param dictionary dictionary from which markers are selected. A copy is not made, so it
+     * must exist while this object is employed
+     */
+    CodebookOptimizer(const Dictionary &dictionary);
+
+    /**Selects markers
+     * @param nMarkers number of markers to select
+     * @param minEntropy markers with lower entropy (see entropy()) are not selected. The first
+     * marker selected is the one with highest entropy
+     * @param minDistance a marker is only added if its distance to the selected ones is at least
+     * this value
+     * @return ids of the markers selected in the order of selection. It may have less than
+     * nMarkers elements if no more markers can be added
+     */
+    std::vector<int> select(int nMarkers,int minEntropy=0,int minDistance=2)const
+      throw (cv::Exception);
+
+    /**Distance between two markers of the dictionary, considering the rotations
+     */
+    int distance(int id1,int id2)const;
+
+    /**Minimum distance between any two markers of the set passed
+     */
+    int getMinDistance(const std::vector<int> &ids)const;
+
+    /**Number of cells of the marker with a different value than the cells at its left and over it
+     * (including the diagonal). Markers with low entropy have big uniform areas and are more likely
+     * to appear in the environment
+     */
+    int entropy(int id)const;
+
+  private:
+
+    const Dictionary &_dict;
+};
+
+}
+
+#endif
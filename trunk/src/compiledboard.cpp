@@ -0,0 +1,228 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "compiledboard.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+namespace
+{
+
+//header of the file. It is followed by: int ids[nMarkers], unsigned int firstCorner[nMarkers+1],
+//int sortedIds[nMarkers], int sortedPos[nMarkers] and float corners[nCorners*3]
+struct CompiledBoardHeader
+{
+  char magic[8];            //"ARUCOBCF"
+  unsigned int version;
+  int infoType;
+  unsigned int nMarkers;
+  unsigned int nCorners;
+  uint64 sourceChecksum;    //of the YAML file
+  uint64 dataChecksum;      //of the data after the header
+};
+
+/*!
+ *  
+ */
+size_t compiledBoardSize(unsigned int nMarkers,unsigned int nCorners)
+{
+  return sizeof(CompiledBoardHeader)+sizeof(int)*(4*size_t(nMarkers)+1)+
+    sizeof(float)*3*size_t(nCorners);
+}
+
+}
+
+/*!
+ *  
+ */
+CompiledBoardConfiguration::CompiledBoardConfiguration()
+{
+  close();
+}
+
+/*!
+ *  
+ */
+void CompiledBoardConfiguration::close()
+{
+  _file.close();
+  _nMarkers=0;
+  _infoType=BoardConfiguration::NONE;
+  _ids=_sortedIds=_sortedPos=0;
+  _firstCorner=0;
+  _corners=0;
+}
+
+/*!
+ *  
+ */
+bool CompiledBoardConfiguration::open(const string &path,uint64 sourceChecksum)
+{
+  close();
+  //the file may not exist yet
+  FILE *test=fopen(path.c_str(),"rb");
+  if (test==0) return false;
+  fclose(test);
+  try
+  {
+    _file.open(path);
+  }
+  catch (cv::Exception &)
+  {
+    return false;
+  }
+  const CompiledBoardHeader *h=(const CompiledBoardHeader*)_file.data();
+  bool valid=_file.size()>=sizeof(CompiledBoardHeader) && memcmp(h->magic,"ARUCOBCF",8)==0 &&
+             h->version==1 && h->sourceChecksum==sourceChecksum &&
+             _file.size()==compiledBoardSize(h->nMarkers,h->nCorners) &&
+             h->dataChecksum==checksum(_file.data()+sizeof(CompiledBoardHeader),
+               _file.size()-sizeof(CompiledBoardHeader));
+  if (!valid)
+  {
+    close();
+    return false;
+  }
+  _nMarkers=h->nMarkers;
+  _infoType=h->infoType;
+  _ids=(const int*)(h+1);
+  _firstCorner=(const unsigned int*)(_ids+_nMarkers);
+  _sortedIds=(const int*)(_firstCorner+_nMarkers+1);
+  _sortedPos=_sortedIds+_nMarkers;
+  _corners=(const Point3f*)(_sortedPos+_nMarkers);
+  return true;
+}
+
+/*!
+ *  
+ */
+int CompiledBoardConfiguration::getIndexOfMarkerId(int id)const
+{
+  const int *it=std::lower_bound(_sortedIds,_sortedIds+_nMarkers,id);
+  if (it==_sortedIds+_nMarkers || *it!=id) return -1;
+  return _sortedPos[it-_sortedIds];
+}
+
+/*!
+ *  
+ */
+void CompiledBoardConfiguration::copyTo(BoardConfiguration &bc)const
+{
+  bc.mInfoType=_infoType;
+  bc.resize(_nMarkers);
+  for (int i=0; i<_nMarkers; i++)
+  {
+    bc[i].id=_ids[i];
+    bc[i].assign(getCorners(i),getCorners(i)+getNumCorners(i));
+  }
+}
+
+/*!
+ *  
+ */
+void CompiledBoardConfiguration::save(const BoardConfiguration &bc,const string &path,
+  uint64 sourceChecksum) throw (cv::Exception)
+{
+  unsigned int nMarkers=bc.size(),nCorners=0;
+  for (size_t i=0; i<bc.size(); i++) nCorners+=bc[i].size();
+  vector<unsigned char> buffer(compiledBoardSize(nMarkers,nCorners));
+  CompiledBoardHeader *h=(CompiledBoardHeader*)&buffer[0];
+  memcpy(h->magic,"ARUCOBCF",8);
+  h->version=1;
+  h->infoType=bc.mInfoType;
+  h->nMarkers=nMarkers;
+  h->nCorners=nCorners;
+  h->sourceChecksum=sourceChecksum;
+  int *ids=(int*)(h+1);
+  unsigned int *firstCorner=(unsigned int*)(ids+nMarkers);
+  int *sortedIds=(int*)(firstCorner+nMarkers+1);
+  int *sortedPos=sortedIds+nMarkers;
+  float *corners=(float*)(sortedPos+nMarkers);
+  //sorted by id and position, so that the first marker of a repeated id is found
+  vector<pair<int,int> > sorted(nMarkers);
+  firstCorner[0]=0;
+  for (unsigned int i=0; i<nMarkers; i++)
+  {
+    ids[i]=bc[i].id;
+    sorted[i]=make_pair(bc[i].id,int(i));
+    firstCorner[i+1]=firstCorner[i]+bc[i].size();
+    for (size_t c=0; c<bc[i].size(); c++)
+    {
+      float *p=corners+3*(firstCorner[i]+c);
+      p[0]=bc[i][c].x;
+      p[1]=bc[i][c].y;
+      p[2]=bc[i][c].z;
+    }
+  }
+  std::sort(sorted.begin(),sorted.end());
+  for (unsigned int i=0; i<nMarkers; i++)
+  {
+    sortedIds[i]=sorted[i].first;
+    sortedPos[i]=sorted[i].second;
+  }
+  h->dataChecksum=checksum(&buffer[0]+sizeof(CompiledBoardHeader),
+    buffer.size()-sizeof(CompiledBoardHeader));
+
+  //written to a temporary file and renamed, so that a reader never maps a partial file
+  string tmpPath=path+".tmp";
+  FILE *file=fopen(tmpPath.c_str(),"wb");
+  if (file==0)
+    throw cv::Exception(9001,"could not open file:"+tmpPath,"CompiledBoardConfiguration::save",
+      __FILE__,__LINE__);
+  bool ok=fwrite(&buffer[0],1,buffer.size(),file)==buffer.size();
+  ok=fclose(file)==0 && ok;
+  //rename does not replace existing files in Windows
+  remove(path.c_str());
+  if (!ok || rename(tmpPath.c_str(),path.c_str())!=0)
+  {
+    remove(tmpPath.c_str());
+    throw cv::Exception(9001,"could not write file:"+path,"CompiledBoardConfiguration::save",
+      __FILE__,__LINE__);
+  }
+}
+
+/*!
+ *  
+ */
+uint64 CompiledBoardConfiguration::checksum(const unsigned char *data,size_t size)
+{
+  uint64 h=uint64(0xcbf29ce4)<<32 | uint64(0x84222325);
+  const uint64 prime=uint64(0x100)<<32 | uint64(0x000001b3);
+  for (size_t i=0; i<size; i++)
+  {
+    h^=data[i];
+    h*=prime;
+  }
+  return h;
+}
+
+}
@@ -0,0 +1,151 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_CompiledBoard_H
+#define _ARUCO_CompiledBoard_H
+#include <opencv2/core/core.hpp>
+#include <string>
+#include "exports.h"
+#include "board.h"
+#include "mappedfile.h"
+namespace aruco
+{
+
+/**\brief Compiled form of a BoardConfiguration, accessed directly from the mapped file.
+ *
+ * It is a flat binary file with the ids, an index of the corners of each marker, the corners
+ * and a table of ids sorted to find the markers by binary search. It stores a checksum of the
+ * YAML file it was created from, so that it is discarded if the YAML file changes, and a
+ * checksum of its own data.
+ *
+ * BoardConfiguration::readFromFile() and saveToFile() create it next to the YAML file (see
+ * getPath()) and employ it instead of parsing the YAML file when it is up to date.
+ */
+class ARUCO_EXPORTS CompiledBoardConfiguration
+{
+  public:
+
+    CompiledBoardConfiguration();
+
+    /**Maps a compiled board
+     * @param path compiled file
+     * @param sourceChecksum checksum of the YAML file it must correspond to
+     * @return false if the file does not exist, is not valid or does not correspond to the YAML
+     * file
+     */
+    bool open(const std::string &path,uint64 sourceChecksum);
+
+    /**
+     */
+    bool isOpen()const
+    {
+      return _file.isOpen();
+    }
+
+    /**Releases the file
+     */
+    void close();
+
+    /**
+     */
+    int getNumMarkers()const
+    {
+      return _nMarkers;
+    }
+
+    /**Type of the coordinates (BoardConfiguration::MarkerInfoType)
+     */
+    int getInfoType()const
+    {
+      return _infoType;
+    }
+
+    /**
+     */
+    int getId(int i)const
+    {
+      return _ids[i];
+    }
+
+    /**
+     */
+    int getNumCorners(int i)const
+    {
+      return _firstCorner[i+1]-_firstCorner[i];
+    }
+
+    /**Corners of the marker i
+     */
+    const cv::Point3f * getCorners(int i)const
+    {
+      return _corners+_firstCorner[i];
+    }
+
+    /**Index of the first marker with the id indicated, or -1. It is a binary search
+     */
+    int getIndexOfMarkerId(int id)const;
+
+    /**Copies the board
+     */
+    void copyTo(BoardConfiguration &bc)const;
+
+    /**Saves a compiled board
+     * @param bc board
+     * @param path output file
+     * @param sourceChecksum checksum of the YAML file of the board
+     */
+    static void save(const BoardConfiguration &bc,const std::string &path,uint64 sourceChecksum)
+      throw (cv::Exception);
+
+    /**Checksum (64 bit FNV-1a) of a block of data
+     */
+    static uint64 checksum(const unsigned char *data,size_t size);
+
+    /**Path of the compiled board of a YAML file
+     */
+    static std::string getPath(const std::string &yamlPath)
+    {
+      return yamlPath+".compiled";
+    }
+
+  private:
+
+    //not copyable
+    CompiledBoardConfiguration(const CompiledBoardConfiguration &);
+    CompiledBoardConfiguration & operator=(const CompiledBoardConfiguration &);
+
+    MappedFile _file;
+    int _nMarkers,_infoType;
+    const int *_ids;
+    const unsigned int *_firstCorner;  //nMarkers+1 elements
+    const int *_sortedIds,*_sortedPos; //ids sorted and the position of each one
+    const cv::Point3f *_corners;
+};
+
+}
+
+#endif
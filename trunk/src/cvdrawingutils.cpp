@@ -53,7 +53,7 @@ void CvDrawingUtils::draw3dAxis(cv::Mat &Image,Marker &m,const CameraParameters
   objectPoints.at<float>(3,2)=size;
 
   vector<Point2f> imagePoints;
-  cv::projectPoints( objectPoints, m.Rvec,m.Tvec, CP.CameraMatrix,CP.Distorsion,   imagePoints);
+  CP.projectPoints(objectPoints,m.Rvec,m.Tvec,imagePoints);
 //draw lines of different colours
   cv::line(Image,imagePoints[0],imagePoints[1],Scalar(0,0,255,255),1,CV_AA);
   cv::line(Image,imagePoints[0],imagePoints[2],Scalar(0,255,0,255),1,CV_AA);
@@ -99,7 +99,7 @@ void CvDrawingUtils::draw3dCube(cv::Mat &Image,Marker &m,const CameraParameters
   objectPoints.at<float>(7,2)=halfSize;
 
   vector<Point2f> imagePoints;
-  projectPoints( objectPoints, m.Rvec,m.Tvec,  CP.CameraMatrix,CP.Distorsion,   imagePoints);
+  CP.projectPoints(objectPoints,m.Rvec,m.Tvec,imagePoints);
 //draw lines of different colours
   for (int i=0; i<4; i++)
     cv::line(Image,imagePoints[i],imagePoints[(i+1)%4],Scalar(0,0,255,255),1,CV_AA);
@@ -135,7 +135,7 @@ void CvDrawingUtils::draw3dAxis(cv::Mat &Image,Board &B,const CameraParameters &
   objectPoints.at<float>(3,2)=2*B[0].ssize;
 
   vector<Point2f> imagePoints;
-  projectPoints( objectPoints, B.Rvec,B.Tvec, CP.CameraMatrix, CP.Distorsion,   imagePoints);
+  CP.projectPoints(objectPoints,B.Rvec,B.Tvec,imagePoints);
 //draw lines of different colours
   cv::line(Image,imagePoints[0],imagePoints[1],Scalar(0,0,255,255),2,CV_AA);
   cv::line(Image,imagePoints[0],imagePoints[2],Scalar(0,255,0,255),2,CV_AA);
@@ -185,7 +185,7 @@ void CvDrawingUtils::draw3dCube(cv::Mat &Image,Board &B,const CameraParameters &
   objectPoints.at<float>(7,2)=txz+cubeSize;
 
   vector<Point2f> imagePoints;
-  projectPoints( objectPoints,B.Rvec,B.Tvec, CP.CameraMatrix, CP.Distorsion,   imagePoints);
+  CP.projectPoints(objectPoints,B.Rvec,B.Tvec,imagePoints);
 //draw lines of different colours
   for (int i=0; i<4; i++)
     cv::line(Image,imagePoints[i],imagePoints[(i+1)%4],Scalar(0,0,255,255),1,CV_AA);
@@ -32,6 +32,9 @@ or implied, of Rafael Muñoz Salinas.
 namespace aruco
 {
 /**\brief A set of functions to draw in opencv images
+ *
+ * Each call projects the points of a single marker or board. To draw the overlay of many
+ * markers, OverlayRenderer does it in a batch.
  */
 class  ARUCO_EXPORTS CvDrawingUtils
 {
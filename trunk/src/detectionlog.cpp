@@ -0,0 +1,385 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "detectionlog.h"
+#include <cstring>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+namespace
+{
+
+/*!
+ *  
+ */
+void fillDetectionLogHeader(DetectionLogHeader &h)
+{
+  memcpy(h.magic,"ARUCOLOG",8);
+  h.version=1;
+  h.byteOrder=0x01020304;
+}
+
+/*!
+ * Copies a rotation or translation vector. If it is not set, -999999 is stored as in Marker
+ */
+void copyPoseVector(const Mat &v,float out[3])
+{
+  if (v.total()!=3)
+  {
+    out[0]=out[1]=out[2]=-999999;
+    return;
+  }
+  Mat f;
+  v.reshape(1,3).convertTo(f,CV_32F);
+  for (int i=0; i<3; i++) out[i]=f.at<float>(i);
+}
+
+/*!
+ *  
+ */
+void setPoseVector(const float in[3],PoseVector &v)
+{
+  v=Mat(3,1,CV_32FC1,(void*)in);
+}
+
+/*!
+ * Positions the file at the offset indicated, that may be beyond 2GB
+ */
+bool seekLogFile(FILE *file,size_t offset)
+{
+#if defined _MSC_VER
+  return _fseeki64(file,__int64(offset),SEEK_SET)==0;
+#else
+  return fseeko(file,off_t(offset),SEEK_SET)==0;
+#endif
+}
+
+/*!
+ * Adds to index the positions of the complete frames from pos, and returns the end of the last
+ * one
+ */
+size_t scanDetectionLog(const unsigned char *data,size_t size,size_t pos,vector<size_t> *index)
+{
+  while (pos+sizeof(DetectionLogFrame)<=size)
+  {
+    const DetectionLogFrame *frame=(const DetectionLogFrame*)(data+pos);
+    size_t expected=sizeof(DetectionLogFrame)+size_t(frame->nMarkers)*sizeof(DetectionLogMarker)+
+      size_t(frame->nBoards)*sizeof(DetectionLogBoard);
+    if (frame->magic!=DetectionLogFrame::Magic || frame->size!=expected ||
+        pos+expected>size) break;
+    if (index!=NULL) index->push_back(pos);
+    pos+=expected;
+  }
+  return pos;
+}
+
+}
+
+/*!
+ *  
+ */
+DetectionLogWriter::DetectionLogWriter(const string &path,bool append,size_t maxPendingBytes)
+  throw (cv::Exception)
+{
+  _file=0;
+  _path=path;
+  _maxPending=maxPendingBytes;
+  _writing=_closing=_error=false;
+
+  //when appending, the new records are written after the last valid one
+  size_t validSize=0;
+  if (append)
+  {
+    FILE *test=fopen(path.c_str(),"rb");
+    if (test!=0)
+    {
+      fclose(test);
+      MappedFile existing;
+      existing.open(path);
+      if (existing.size()>0)
+        validSize=DetectionLogReader::scan(existing.data(),existing.size());
+    }
+  }
+  if (validSize>0)
+  {
+    _file=fopen(path.c_str(),"r+b");
+    if (_file!=0 && !seekLogFile(_file,validSize))
+    {
+      fclose(_file);
+      _file=0;
+    }
+  }
+  else
+  {
+    _file=fopen(path.c_str(),"wb");
+    if (_file!=0)
+    {
+      DetectionLogHeader header;
+      fillDetectionLogHeader(header);
+      if (fwrite(&header,sizeof(header),1,_file)!=1)
+      {
+        fclose(_file);
+        _file=0;
+      }
+    }
+  }
+  if (_file==0)
+    throw cv::Exception(9001,"could not open file:"+path,"DetectionLogWriter::DetectionLogWriter",
+      __FILE__,__LINE__);
+  _thread.start(threadMain,this);
+}
+
+/*!
+ *  
+ */
+DetectionLogWriter::~DetectionLogWriter()
+{
+  try
+  {
+    close();
+  }
+  catch (std::exception &)
+  {
+  }
+}
+
+/*!
+ *  
+ */
+void DetectionLogWriter::threadMain(void *writer)
+{
+  ((DetectionLogWriter*)writer)->run();
+}
+
+/*!
+ * The records pending are swapped with an empty buffer, so that write() can add new ones while
+ * the previous ones are being written
+ */
+void DetectionLogWriter::run()
+{
+  vector<char> buffer;
+  _mutex.lock();
+  while (true)
+  {
+    while (_pending.empty() && !_closing) _changed.wait(_mutex);
+    if (_pending.empty()) break;
+    buffer.swap(_pending);
+    _writing=true;
+    _mutex.unlock();
+    bool ok=fwrite(&buffer[0],1,buffer.size(),_file)==buffer.size() && fflush(_file)==0;
+    buffer.clear();
+    _mutex.lock();
+    _writing=false;
+    if (!ok) _error=true;
+    _changed.broadcast();
+  }
+  _mutex.unlock();
+}
+
+/*!
+ *  
+ */
+void DetectionLogWriter::checkError() throw (cv::Exception)
+{
+  if (_error)
+    throw cv::Exception(9001,"error writing file:"+_path,"DetectionLogWriter",__FILE__,__LINE__);
+}
+
+/*!
+ *  
+ */
+void DetectionLogWriter::write(double timestamp,int cameraId,const vector<Marker> &markers,
+  const vector<Board> &boards) throw (cv::Exception)
+{
+  if (_file==0)
+    throw cv::Exception(9001,"the log is closed","DetectionLogWriter::write",__FILE__,__LINE__);
+  //the record is serialized without the lock
+  size_t size=sizeof(DetectionLogFrame)+markers.size()*sizeof(DetectionLogMarker)+
+    boards.size()*sizeof(DetectionLogBoard);
+  vector<char> record(size,0);
+  DetectionLogFrame *frame=(DetectionLogFrame*)&record[0];
+  frame->magic=DetectionLogFrame::Magic;
+  frame->size=size;
+  frame->timestamp=timestamp;
+  frame->cameraId=cameraId;
+  frame->nMarkers=markers.size();
+  frame->nBoards=boards.size();
+  DetectionLogMarker *m=(DetectionLogMarker*)(frame+1);
+  for (size_t i=0; i<markers.size(); i++,m++)
+  {
+    m->id=markers[i].id;
+    m->ssize=markers[i].ssize;
+    for (size_t c=0; c<4 && c<markers[i].size(); c++)
+    {
+      m->corners[c*2]=markers[i][c].x;
+      m->corners[c*2+1]=markers[i][c].y;
+    }
+    copyPoseVector(markers[i].Rvec,m->rvec);
+    copyPoseVector(markers[i].Tvec,m->tvec);
+  }
+  DetectionLogBoard *b=(DetectionLogBoard*)m;
+  for (size_t i=0; i<boards.size(); i++,b++)
+  {
+    b->index=i;
+    b->nMarkers=boards[i].size();
+    copyPoseVector(boards[i].Rvec,b->rvec);
+    copyPoseVector(boards[i].Tvec,b->tvec);
+  }
+
+  ScopedLock lock(_mutex);
+  checkError();
+  //waits if there are too many records pending
+  while (!_pending.empty() && _pending.size()+size>_maxPending && !_error)
+    _changed.wait(_mutex);
+  checkError();
+  _pending.insert(_pending.end(),record.begin(),record.end());
+  _changed.broadcast();
+}
+
+/*!
+ *  
+ */
+void DetectionLogWriter::flush() throw (cv::Exception)
+{
+  if (_file==0) return;
+  ScopedLock lock(_mutex);
+  while ((!_pending.empty() || _writing) && !_error)
+    _changed.wait(_mutex);
+  checkError();
+}
+
+/*!
+ *  
+ */
+void DetectionLogWriter::close() throw (cv::Exception)
+{
+  if (_file==0) return;
+  _mutex.lock();
+  _closing=true;
+  _changed.broadcast();
+  _mutex.unlock();
+  _thread.join();
+  bool ok=fclose(_file)==0;
+  _file=0;
+  if (!ok) _error=true;
+  checkError();
+}
+
+/*!
+ *  
+ */
+size_t DetectionLogReader::scan(const unsigned char *data,size_t size,vector<size_t> *index)
+  throw (cv::Exception)
+{
+  DetectionLogHeader expected;
+  fillDetectionLogHeader(expected);
+  if (size<sizeof(DetectionLogHeader) ||
+      memcmp(data,&expected,sizeof(DetectionLogHeader))!=0)
+    throw cv::Exception(9001,"invalid detection log (or written with other byte order)",
+      "DetectionLogReader::scan",__FILE__,__LINE__);
+  return scanDetectionLog(data,size,sizeof(DetectionLogHeader),index);
+}
+
+/*!
+ *  
+ */
+DetectionLogReader::DetectionLogReader()
+{
+}
+
+/*!
+ *  
+ */
+DetectionLogReader::DetectionLogReader(const string &path) throw (cv::Exception)
+{
+  open(path);
+}
+
+/*!
+ *  
+ */
+void DetectionLogReader::open(const string &path) throw (cv::Exception)
+{
+  _index.clear();
+  _path=path;
+  _file.open(path);
+  scan(_file.data(),_file.size(),&_index);
+}
+
+/*!
+ *  
+ */
+size_t DetectionLogReader::update() throw (cv::Exception)
+{
+  //the frames already indexed do not change, so only the new part is scanned
+  size_t pos=sizeof(DetectionLogHeader);
+  if (!_index.empty())
+    pos=_index.back()+getFrame(_index.size()-1).size;
+  _file.open(_path);
+  if (_file.size()<pos)
+    throw cv::Exception(9001,"the log has been truncated","DetectionLogReader::update",
+      __FILE__,__LINE__);
+  scanDetectionLog(_file.data(),_file.size(),pos,&_index);
+  return _index.size();
+}
+
+/*!
+ *  
+ */
+void DetectionLogReader::getFrame(size_t i,double &timestamp,int &cameraId,
+  vector<Marker> &markers,vector<Board> *boards)const
+{
+  const DetectionLogFrame &frame=getFrame(i);
+  timestamp=frame.timestamp;
+  cameraId=frame.cameraId;
+  const DetectionLogMarker *m=getMarkers(i);
+  markers.resize(frame.nMarkers);
+  for (size_t j=0; j<frame.nMarkers; j++)
+  {
+    markers[j].id=m[j].id;
+    markers[j].ssize=m[j].ssize;
+    markers[j].resize(4);
+    for (int c=0; c<4; c++)
+      markers[j][c]=Point2f(m[j].corners[c*2],m[j].corners[c*2+1]);
+    setPoseVector(m[j].rvec,markers[j].Rvec);
+    setPoseVector(m[j].tvec,markers[j].Tvec);
+  }
+  if (boards!=NULL)
+  {
+    const DetectionLogBoard *b=getBoards(i);
+    boards->resize(frame.nBoards);
+    for (size_t j=0; j<frame.nBoards; j++)
+    {
+      setPoseVector(b[j].rvec,(*boards)[j].Rvec);
+      setPoseVector(b[j].tvec,(*boards)[j].Tvec);
+    }
+  }
+}
+
+}
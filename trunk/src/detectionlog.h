@@ -0,0 +1,229 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_DetectionLog_H
+#define _ARUCO_DetectionLog_H
+#include <opencv2/core/core.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "exports.h"
+#include "marker.h"
+#include "board.h"
+#include "mutex.h"
+#include "thread.h"
+#include "mappedfile.h"
+namespace aruco
+{
+
+/** \file detectionlog.h
+ * Binary log of detections. The file is a header (DetectionLogHeader) followed by a record for
+ * each frame: a DetectionLogFrame, its markers (DetectionLogMarker) and its boards
+ * (DetectionLogBoard). All the sizes are multiple of 8 bytes, so that the records can be read
+ * directly from the mapped file. The data is stored in the byte order of the machine that writes
+ * it.
+ */
+
+/**\brief Header of the file
+ */
+struct DetectionLogHeader
+{
+  char magic[8];          ///< "ARUCOLOG"
+  unsigned int version;   ///< 1
+  unsigned int byteOrder; ///< 0x01020304 written in the order of the machine
+};
+
+/**\brief Header of the record of a frame
+ */
+struct DetectionLogFrame
+{
+  unsigned int magic;     ///< DetectionLogFrame::Magic
+  unsigned int size;      ///< size of the record in bytes, including this header
+  double timestamp;       ///< time of the frame, in the units employed by the application
+  int cameraId;
+  unsigned int nMarkers;
+  unsigned int nBoards;
+  unsigned int reserved;
+  enum {Magic=0x43455241}; //"AREC"
+};
+
+/**\brief Marker of a frame
+ */
+struct DetectionLogMarker
+{
+  int id;
+  float ssize;            ///< size in meters, -1 if unknown
+  float corners[8];       ///< x,y of the four corners
+  float rvec[3],tvec[3];  ///< pose. -999999 if unknown
+};
+
+/**\brief Board of a frame
+ */
+struct DetectionLogBoard
+{
+  int index;              ///< position of the board in the vector logged
+  int nMarkers;           ///< number of markers of the board detected
+  float rvec[3],tvec[3];  ///< pose. -999999 if unknown
+};
+
+/**\brief Writes a detection log. The records are serialized in the calling thread and written
+ * to the file by a background thread, so that write() does not block on the disk unless more
+ * than maxPendingBytes are waiting.
+ */
+class ARUCO_EXPORTS DetectionLogWriter
+{
+  public:
+
+    /**
+     * @param path file
+     * @param append if true and the file exists, the records are added at the end of the valid
+     * records of the file. Otherwise, the file is overwritten
+     * @param maxPendingBytes max size of the records waiting to be written
+     */
+    DetectionLogWriter(const std::string &path,bool append=false,
+      size_t maxPendingBytes=64*1024*1024) throw (cv::Exception);
+
+    /**Writes the records pending and closes the file
+     */
+    ~DetectionLogWriter();
+
+    /**Adds the record of a frame
+     * @param timestamp time of the frame
+     * @param cameraId camera that captured it
+     * @param markers markers detected
+     * @param boards boards detected. Their poses and number of markers are logged, not their
+     * configurations
+     */
+    void write(double timestamp,int cameraId,const std::vector<Marker> &markers,
+      const std::vector<Board> &boards=std::vector<Board>()) throw (cv::Exception);
+
+    /**Waits until all the records are written to the file
+     */
+    void flush() throw (cv::Exception);
+
+    /**Writes the records pending and closes the file
+     */
+    void close() throw (cv::Exception);
+
+  private:
+
+    //not copyable
+    DetectionLogWriter(const DetectionLogWriter &);
+    DetectionLogWriter & operator=(const DetectionLogWriter &);
+
+    static void threadMain(void *writer);
+    void run();
+    //throws if the background thread failed. Called with the mutex locked
+    void checkError() throw (cv::Exception);
+
+    FILE *_file;
+    std::string _path;
+    size_t _maxPending;
+    std::vector<char> _pending;   //records waiting to be written
+    bool _writing;                //the thread is writing a block
+    bool _closing;
+    bool _error;
+    Mutex _mutex;
+    Condition _changed;           //signaled when there are new records or they are written
+    Thread _thread;
+};
+
+/**\brief Reads a detection log mapped in memory. Opening it only creates an index with the
+ * position of each frame, and the records are accessed without copies.
+ */
+class ARUCO_EXPORTS DetectionLogReader
+{
+  public:
+
+    DetectionLogReader();
+
+    /**
+     */
+    DetectionLogReader(const std::string &path) throw (cv::Exception);
+
+    /**Maps the file and indexes its frames
+     */
+    void open(const std::string &path) throw (cv::Exception);
+
+    /**Maps again the file to access the frames added since it was opened (e.g. while it is
+     * being written). The pointers returned previously are no longer valid
+     * @return number of frames
+     */
+    size_t update() throw (cv::Exception);
+
+    /**Number of frames. An incomplete record at the end of the file is not counted
+     */
+    size_t size()const
+    {
+      return _index.size();
+    }
+
+    /**Header of the frame i
+     */
+    const DetectionLogFrame & getFrame(size_t i)const
+    {
+      return *(const DetectionLogFrame*)(_file.data()+_index[i]);
+    }
+
+    /**Markers of the frame i (getFrame(i).nMarkers)
+     */
+    const DetectionLogMarker * getMarkers(size_t i)const
+    {
+      return (const DetectionLogMarker*)(_file.data()+_index[i]+sizeof(DetectionLogFrame));
+    }
+
+    /**Boards of the frame i (getFrame(i).nBoards)
+     */
+    const DetectionLogBoard * getBoards(size_t i)const
+    {
+      return (const DetectionLogBoard*)(getMarkers(i)+getFrame(i).nMarkers);
+    }
+
+    /**Copies the frame i to the classes of the library. Only the fields logged are set in
+     * the boards
+     */
+    void getFrame(size_t i,double &timestamp,int &cameraId,std::vector<Marker> &markers,
+      std::vector<Board> *boards=NULL)const;
+
+    /**Size of the valid part of a log, i.e., the header and the complete records. The positions
+     * of the frames are added to index if it is not NULL
+     * @param data content of the file
+     * @param size size of the content
+     */
+    static size_t scan(const unsigned char *data,size_t size,std::vector<size_t> *index=NULL)
+      throw (cv::Exception);
+
+  private:
+
+    std::string _path;
+    MappedFile _file;
+    std::vector<size_t> _index;   //position of each frame in the file
+};
+
+}
+
+#endif
@@ -0,0 +1,478 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "dictionary.h"
+#include <opencv2/imgproc/imgproc.hpp>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+//max width of the border, so that the cells of a marker can be counted in a stack buffer
+const int maxBorderWidth=3;
+
+/*!
+ *  
+ */
+Dictionary::Dictionary(int gridSize,int borderWidth) throw (cv::Exception)
+{
+  if (gridSize<2 || gridSize>8)
+    throw cv::Exception(9005,"gridSize must be in [2,8]","Dictionary::Dictionary",
+      __FILE__,__LINE__);
+  if (borderWidth<1 || borderWidth>maxBorderWidth)
+    throw cv::Exception(9005,"borderWidth must be in [1,3]","Dictionary::Dictionary",
+      __FILE__,__LINE__);
+  _gridSize=gridSize;
+  _borderWidth=borderWidth;
+  _minDistance=-1;
+  _maxCorrection=0;
+}
+
+/*!
+ *  
+ */
+void Dictionary::add(uint64 code)
+{
+  add(vector<uint64>(1,code));
+}
+
+/*!
+ *  
+ */
+void Dictionary::add(const std::vector<uint64> &codes)
+{
+  //the markers added are not part of the row code anymore, so that the correction table of all
+  //the markers is created below
+  bool wasRowCode=!_rowWords.empty();
+  _rowWords.clear();
+  _rowNearest.clear();
+  _rowDist.clear();
+  size_t nIndex=_index.size(),nCorrections=_correctionIndex.size();
+  _codes.reserve(_codes.size()+4*codes.size());
+  _index.reserve(_index.size()+4*codes.size());
+  for (size_t i=0; i<codes.size(); i++)
+  {
+    uint64 code=codes[i];
+    for (int r=0; r<4; r++)
+    {
+      _index.push_back(pair<uint64,int>(code,_codes.size()));
+      if (_maxCorrection>0 && !wasRowCode) addCorrections(code,_codes.size(),0,0);
+      _codes.push_back(code);
+      code=rotate(code,_gridSize);
+    }
+  }
+  _minDistance=-1;
+  //the index is kept sorted by code and then by position. The new elements are sorted and merged
+  //once, instead of inserting each one in its place
+  std::sort(_index.begin()+nIndex,_index.end());
+  std::inplace_merge(_index.begin(),_index.begin()+nIndex,_index.end());
+  if (wasRowCode)
+  {
+    if (_maxCorrection>0) setMaxCorrectionBits(_maxCorrection);
+    return;
+  }
+  //merge the new elements in the correction index
+  if (nCorrections!=_correctionIndex.size())
+  {
+    std::sort(_correctionIndex.begin()+nCorrections,_correctionIndex.end());
+    std::inplace_merge(_correctionIndex.begin(),_correctionIndex.begin()+nCorrections,
+      _correctionIndex.end());
+  }
+}
+
+/*!
+ *  
+ */
+void Dictionary::addCorrections(uint64 code,int pos,int firstBit,int dist)
+{
+  if (dist==_maxCorrection) return;
+  int nBits=_gridSize*_gridSize;
+  for (int b=firstBit; b<nBits; b++)
+  {
+    uint64 wrong=code^(uint64(1)<<b);
+    _correctionIndex.push_back(pair<uint64,int>(wrong,(pos<<4)|(dist+1)));
+    addCorrections(wrong,pos,b+1,dist+1);
+  }
+}
+
+/*!
+ *  
+ */
+void Dictionary::setMaxCorrectionBits(int nBits) throw (cv::Exception)
+{
+  if (nBits<0 || nBits>15)
+    throw cv::Exception(9005,"nBits must be in [0,15]","Dictionary::setMaxCorrectionBits",
+      __FILE__,__LINE__);
+  _maxCorrection=nBits;
+  _correctionIndex.clear();
+  //row codes employ their table of words
+  if (!_rowWords.empty() || nBits==0) return;
+
+  //number of elements: for each codeword, the combinations of up to nBits bits
+  double nElements=0,comb=1;
+  int totalBits=_gridSize*_gridSize;
+  for (int k=1; k<=nBits; k++)
+  {
+    comb=comb*(totalBits-k+1)/k;
+    nElements+=comb;
+  }
+  nElements*=_codes.size();
+  if (nElements>double(1<<22))
+  {
+    _maxCorrection=0;
+    throw cv::Exception(9005,"correction table too big. Reduce nBits",
+      "Dictionary::setMaxCorrectionBits",__FILE__,__LINE__);
+  }
+  _correctionIndex.reserve(nElements);
+  for (size_t i=0; i<_codes.size(); i++)
+    addCorrections(_codes[i],i,0,0);
+  std::sort(_correctionIndex.begin(),_correctionIndex.end());
+}
+
+/*!
+ *  
+ */
+Dictionary Dictionary::createRowCode(int gridSize,const std::vector<uint64> &rowWords,
+  int borderWidth) throw (cv::Exception)
+{
+  Dictionary dict(gridSize,borderWidth);
+  int nWords=rowWords.size();
+  if (nWords<1 || pow(double(nWords),gridSize)>65536)
+    throw cv::Exception(9005,"invalid number of words","Dictionary::createRowCode",
+      __FILE__,__LINE__);
+  int nMarkers=1;
+  for (int y=0; y<gridSize; y++) nMarkers*=nWords;
+  uint64 rowMask=(uint64(1)<<gridSize)-1;
+  vector<uint64> codes(nMarkers);
+  for (int id=0; id<nMarkers; id++)
+  {
+    //digits of the id in base nWords, first row most significant
+    uint64 code=0;
+    for (int y=0,div=nMarkers/nWords; y<gridSize; y++,div/=nWords)
+      code=(code<<gridSize)|(rowWords[(id/div)%nWords]&rowMask);
+    codes[id]=code;
+  }
+  dict.add(codes);
+  dict._rowWords=rowWords;
+
+  //table with the nearest word of each possible row
+  int nRows=1<<gridSize;
+  dict._rowNearest.assign(nRows,-1);
+  dict._rowDist.assign(nRows,0);
+  for (int row=0; row<nRows; row++)
+  {
+    int minDist=gridSize+1;
+    for (int w=0; w<nWords; w++)
+    {
+      int dist=popCount(uint64(row)^(rowWords[w]&rowMask));
+      if (dist<minDist)
+      {
+        minDist=dist;
+        dict._rowNearest[row]=w;
+      }
+      else if (dist==minDist) dict._rowNearest[row]=-1;//ambiguous
+    }
+    dict._rowDist[row]=minDist;
+  }
+  return dict;
+}
+
+/*!
+ *  
+ */
+void Dictionary::add(const cv::Mat &bits) throw (cv::Exception)
+{
+  if (bits.rows!=_gridSize || bits.cols!=_gridSize || bits.type()!=CV_8UC1)
+    throw cv::Exception(9005,"invalid bits matrix","Dictionary::add",__FILE__,__LINE__);
+  uint64 code=0;
+  for (int y=0; y<_gridSize; y++)
+    for (int x=0; x<_gridSize; x++)
+    {
+      code<<=1;
+      if (bits.at<uchar>(y,x)) code|=1;
+    }
+  add(code);
+}
+
+/*!
+ *  
+ */
+uint64 Dictionary::rotate(uint64 code,int gridSize)
+{
+  //the cell (x,y) of the output is the cell (y,n-1-x) of the input
+  int nBits=gridSize*gridSize;
+  uint64 out=0;
+  for (int y=0; y<gridSize; y++)
+    for (int x=0; x<gridSize; x++)
+    {
+      int in=nBits-1-((gridSize-1-x)*gridSize+y);
+      if ((code>>in)&1) out|=uint64(1)<<(nBits-1-(y*gridSize+x));
+    }
+  return out;
+}
+
+/*!
+ *  
+ */
+int Dictionary::getMinDistance()const
+{
+  if (_minDistance>=0) return _minDistance;
+  int minDist=_gridSize*_gridSize;
+  int n=size();
+  for (int i=0; i<n; i++)
+  {
+    uint64 code=_codes[i*4];
+    //with its own rotations
+    for (int r=1; r<4; r++)
+      minDist=std::min(minDist,popCount(code^_codes[i*4+r]));
+    //with the rest of markers
+    for (int j=i+1; j<n; j++)
+      for (int r=0; r<4; r++)
+        minDist=std::min(minDist,popCount(code^_codes[j*4+r]));
+  }
+  _minDistance=minDist;
+  return _minDistance;
+}
+
+/*!
+ *  
+ */
+cv::Mat Dictionary::getMarkerMat(int id)const throw (cv::Exception)
+{
+  if (id<0 || id>=size())
+    throw cv::Exception(9004,"id invalid","Dictionary::getMarkerMat",__FILE__,__LINE__);
+  Mat marker(_gridSize,_gridSize,CV_8UC1);
+  uint64 code=_codes[id*4];
+  int nBits=_gridSize*_gridSize;
+  for (int y=0; y<_gridSize; y++)
+    for (int x=0; x<_gridSize; x++)
+      marker.at<uchar>(y,x)=(code>>(nBits-1-(y*_gridSize+x)))&1;
+  return marker;
+}
+
+/*!
+ *  
+ */
+cv::Mat Dictionary::createMarkerImage(int id,int size)const throw (cv::Exception)
+{
+  Mat bits=getMarkerMat(id);
+  int nCells=_gridSize+2*_borderWidth;
+  Mat marker(size,size,CV_8UC1);
+  marker.setTo(Scalar(0));
+  int swidth=size/nCells;
+  for (int y=0; y<_gridSize; y++)
+    for (int x=0; x<_gridSize; x++)
+      if (bits.at<uchar>(y,x))
+      {
+        Mat roi=marker(Rect((x+_borderWidth)*swidth,(y+_borderWidth)*swidth,swidth,swidth));
+        roi.setTo(Scalar(255));
+      }
+  return marker;
+}
+
+/*!
+ *  
+ */
+int Dictionary::identify(uint64 bits,int &nRotations)const
+{
+  //The bits read, rotated i times, must be the marker. So, the bits are the marker rotated
+  //4-i times. If several markers match (symmetric markers), the smallest i is taken, as in
+  //FiducidalMarkers
+  vector<pair<uint64,int> >::const_iterator it=
+    std::lower_bound(_index.begin(),_index.end(),pair<uint64,int>(bits,0));
+  int best=-1,bestRot=4;
+  for (; it!=_index.end() && it->first==bits; ++it)
+  {
+    int i=(4-it->second%4)%4;
+    if (i<bestRot)
+    {
+      bestRot=i;
+      best=it->second/4;
+    }
+  }
+  if (best!=-1)
+  {
+    nRotations=bestRot;
+    return best;
+  }
+  if (_maxCorrection==0) return -1;
+  if (!_rowWords.empty()) return identifyRows(bits,nRotations);
+  return identifyCorrecting(bits,nRotations);
+}
+
+/*!
+ * Each row of the bits, in each rotation, is replaced by its nearest word. The rotation with less
+ * errors is taken, and if another rotation gives a different marker with the same errors, the bits
+ * are rejected
+ */
+int Dictionary::identifyRows(uint64 bits,int &nRotations)const
+{
+  int nWords=_rowWords.size();
+  uint64 rowMask=(uint64(1)<<_gridSize)-1;
+  int bestDist=_maxCorrection+1,bestId=-1,bestRot=0;
+  bool ambiguous=false;
+  for (int i=0; i<4; i++)
+  {
+    if (i>0) bits=rotate(bits,_gridSize);
+    int dist=0,id=0;
+    for (int y=0; y<_gridSize && dist<=bestDist; y++)
+    {
+      int row=(bits>>(_gridSize*(_gridSize-1-y)))&rowMask;
+      if (_rowNearest[row]<0) dist=bestDist+1;
+      else
+      {
+        dist+=_rowDist[row];
+        id=id*nWords+_rowNearest[row];
+      }
+    }
+    if (dist<bestDist)
+    {
+      bestDist=dist;
+      bestId=id;
+      bestRot=i;
+      ambiguous=false;
+    }
+    else if (dist==bestDist && bestId!=-1 && id!=bestId) ambiguous=true;
+  }
+  if (bestId==-1 || ambiguous) return -1;
+  nRotations=bestRot;
+  return bestId;
+}
+
+/*!
+ * The codewords with errors are found by binary search. The ones with less errors are taken,
+ * and if they belong to different markers, the bits are rejected
+ */
+int Dictionary::identifyCorrecting(uint64 bits,int &nRotations)const
+{
+  vector<pair<uint64,int> >::const_iterator first=std::lower_bound(_correctionIndex.begin(),
+    _correctionIndex.end(),pair<uint64,int>(bits,0)),it;
+  int bestDist=_maxCorrection+1;
+  for (it=first; it!=_correctionIndex.end() && it->first==bits; ++it)
+    bestDist=std::min(bestDist,it->second&15);
+  int best=-1,bestRot=4;
+  for (it=first; it!=_correctionIndex.end() && it->first==bits; ++it)
+  {
+    if ((it->second&15)!=bestDist) continue;
+    int pos=it->second>>4;
+    if (best!=-1 && best!=pos/4) return -1;//ambiguous
+    best=pos/4;
+    bestRot=std::min(bestRot,(4-pos%4)%4);
+  }
+  if (best!=-1) nRotations=bestRot;
+  return best;
+}
+
+/*!
+ * The image is divided in nCells x nCells regions. The white pixels of each region are counted in
+ * a single pass, and the regions with more than half of their pixels white are ones. The loops
+ * of the inner cells depend on the template parameter, so they are unrolled for each grid size
+ */
+template<int N>
+bool Dictionary::readBits(const cv::Mat &binary,uint64 &bits)const
+{
+  const int maxCells=8+2*maxBorderWidth;
+  int nCells=N+2*_borderWidth;
+  int counts[maxCells*maxCells],area[maxCells*maxCells];
+  for (int i=0; i<nCells*nCells; i++) counts[i]=area[i]=0;
+  for (int y=0; y<binary.rows; y++)
+  {
+    const uchar *ptr=binary.ptr<uchar>(y);
+    int *cRow=counts+(y*nCells/binary.rows)*nCells,*aRow=area+(y*nCells/binary.rows)*nCells;
+    for (int cx=0; cx<nCells; cx++)
+    {
+      int x0=cx*binary.cols/nCells,x1=(cx+1)*binary.cols/nCells;
+      int sum=0;
+      for (int x=x0; x<x1; x++) sum+=ptr[x]!=0;
+      cRow[cx]+=sum;
+      aRow[cx]+=x1-x0;
+    }
+  }
+  //the border must be black
+  for (int cy=0; cy<nCells; cy++)
+    for (int cx=0; cx<nCells; cx++)
+    {
+      bool isBorder=cx<_borderWidth || cy<_borderWidth || cx>=nCells-_borderWidth ||
+        cy>=nCells-_borderWidth;
+      if (isBorder && counts[cy*nCells+cx]*2>area[cy*nCells+cx]) return false;
+    }
+  bits=0;
+  for (int y=0; y<N; y++)
+  {
+    const int *cRow=counts+(y+_borderWidth)*nCells+_borderWidth;
+    const int *aRow=area+(y+_borderWidth)*nCells+_borderWidth;
+    for (int x=0; x<N; x++)
+      bits=(bits<<1)|uint64(cRow[x]*2>aRow[x]);
+  }
+  return true;
+}
+
+/*!
+ *  
+ */
+int Dictionary::detect(const cv::Mat &in,int &nRotations)const
+{
+  assert(in.rows==in.cols);
+  Mat grey;
+  if ( in.type()==CV_8UC1) grey=in;
+  else cv::cvtColor(in,grey,CV_BGR2GRAY);
+  //threshold image
+  Mat binary;
+  threshold(grey, binary,125, 255, THRESH_BINARY|THRESH_OTSU);
+
+  uint64 bits=0;
+  bool ok=false;
+  switch (_gridSize)
+  {
+  case 2: ok=readBits<2>(binary,bits); break;
+  case 3: ok=readBits<3>(binary,bits); break;
+  case 4: ok=readBits<4>(binary,bits); break;
+  case 5: ok=readBits<5>(binary,bits); break;
+  case 6: ok=readBits<6>(binary,bits); break;
+  case 7: ok=readBits<7>(binary,bits); break;
+  case 8: ok=readBits<8>(binary,bits); break;
+  };
+  if (!ok) return -1;
+  return identify(bits,nRotations);
+}
+
+/*!
+ *  
+ */
+const Dictionary & Dictionary::getArucoDictionary()
+{
+  //each row is one of these words, that encode 2 bits (see FiducidalMarkers::createMarkerImage)
+  static const uint64 words[4]={0x10,0x17,0x09,0x0e};
+  static Dictionary dict=createRowCode(5,vector<uint64>(words,words+4));
+  return dict;
+}
+
+//the dictionary of the library is created when the library is loaded, so that it is not created
+//concurrently by several threads later
+static const Dictionary &arucoDictionary=Dictionary::getArucoDictionary();
+
+}
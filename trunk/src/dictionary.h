@@ -0,0 +1,233 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_Dictionary_H
+#define _ARUCO_Dictionary_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include <utility>
+#include "exports.h"
+namespace aruco
+{
+
+/**\brief A set of square markers (codebook).
+ *
+ * Each marker is a grid of gridSize x gridSize bits surrounded by a black border of borderWidth
+ * cells. The bits of a marker are stored in a 64 bit codeword, so that gridSize can be at most 8.
+ * The bit of the cell (x,y) is the bit gridSize*gridSize-1-(y*gridSize+x), i.e., the first cell
+ * is the most significant bit. The id of a marker is its position in the dictionary.
+ *
+ * The four rotations of each codeword are precomputed and indexed, so that a marker is identified
+ * by a binary search of the bits read. Distances between codewords are calculated with xor and
+ * popcount. The decoders are specialized for each grid size (templates), so that the loops
+ * reading the cells are unrolled by the compiler.
+ *
+ * The markers of the library (see FiducidalMarkers) are available with getArucoDictionary().
+ */
+class ARUCO_EXPORTS Dictionary
+{
+  public:
+
+    /**Creates an empty dictionary
+     * @param gridSize number of bits of each side of the markers [2,8]
+     * @param borderWidth number of cells of the black border around the bits [1,3]
+     */
+    Dictionary(int gridSize=5,int borderWidth=1) throw (cv::Exception);
+
+    /**Adds a marker. Its id is the number of markers previously added. If the dictionary was
+     * a row code (see createRowCode) with correction of errors, it is not a row code anymore and
+     * the correction table of all its markers is created, so that an exception is thrown if it
+     * would be too big (see setMaxCorrectionBits). To add many markers, the version with a
+     * vector of codes is faster
+     */
+    void add(uint64 code);
+
+    /**Adds several markers, in the order of the vector. The index of the dictionary is sorted once
+     * for all of them
+     */
+    void add(const std::vector<uint64> &codes);
+
+    /**Adds a marker given as a gridSize x gridSize 8UC1 matrix of 0s and 1s
+     */
+    void add(const cv::Mat &bits) throw (cv::Exception);
+
+    /**Number of markers
+     */
+    int size()const
+    {
+      return _codes.size()/4;
+    }
+
+    /**
+     */
+    int getGridSize()const
+    {
+      return _gridSize;
+    }
+
+    /**
+     */
+    int getBorderWidth()const
+    {
+      return _borderWidth;
+    }
+
+    /**Returns the codeword of a marker
+     * @param id id of the marker
+     * @param nRotations number of 90 deg clockwise rotations applied to the marker [0,3]
+     */
+    uint64 getCode(int id,int nRotations=0)const
+    {
+      return _codes[id*4+nRotations];
+    }
+
+    /**Minimum hamming distance between any two markers of the dictionary, including their
+     * rotations, and between each marker and its own rotations. It is the quantity that indicates
+     * how robust the dictionary is. It is calculated the first time it is requested and kept
+     * until a marker is added, so that the first call is not thread safe: call it before sharing
+     * the dictionary between threads.
+     */
+    int getMinDistance()const;
+
+    /**Returns a gridSize x gridSize 8UC1 matrix of 0s and 1s with the bits of the marker
+     */
+    cv::Mat getMarkerMat(int id)const throw (cv::Exception);
+
+    /**Creates a printable image of the marker, including its black border
+     * @param id id of the marker
+     * @param size size of the image in pixels
+     */
+    cv::Mat createMarkerImage(int id,int size)const throw (cv::Exception);
+
+    /**Finds the marker with the bits passed.
+     * @param bits codeword read from the image
+     * @param nRotations output number of 90deg rotations in clockwise direction needed to set the
+     * marker in correct position
+     * @return the id of the marker or -1 if it is not in the dictionary
+     */
+    int identify(uint64 bits,int &nRotations)const;
+
+    /**Detection of the markers of the dictionary in a canonical image, in the same manner than
+     * FiducidalMarkers::detect. The image is binarized by Otsu, the border must be black and
+     * the cells are read by majority
+     * @param in input image with the patch that contains the possible marker.
+     * @param nRotations number of 90deg rotations in clockwise direction needed to set the
+     * marker in correct position.
+     * @return -1 if the image passed is a not a valid marker, and its id otherwise
+     */
+    int detect(const cv::Mat &in,int &nRotations)const;
+
+    /**Rotates 90 deg clockwise a codeword of a grid of the size indicated
+     */
+    static uint64 rotate(uint64 code,int gridSize);
+
+    /**Number of bits set
+     */
+    static int popCount(uint64 v)
+    {
+#if defined(__GNUC__)
+      return __builtin_popcountll(v);
+#else
+      //SWAR population count. The masks are 0x55..,0x33..,0x0f.. and 0x01..
+      const uint64 m1=~uint64(0)/3,m2=~uint64(0)/5,m4=~uint64(0)/17;
+      const uint64 h01=~uint64(0)/255;
+      v-=(v>>1)&m1;
+      v=(v&m2)+((v>>2)&m2);
+      v=(v+(v>>4))&m4;
+      return int((v*h01)>>56);
+#endif
+    }
+
+    /**Sets the max number of wrong bits that are corrected when identifying a marker. By default, 0.
+     * The correction is done by means of precomputed tables, so that it costs the same as the
+     * exact identification:
+     * - In dictionaries created with createRowCode, each row is corrected with a table with the
+     * nearest word to each possible row.
+     * - Otherwise, a sorted table with all the codewords at distance <=nBits from the markers
+     * (and their rotations) is created. Its size grows quickly with nBits, so an exception is
+     * thrown if it would have more than 2^22 elements.
+     *
+     * Codewords at the same distance of two different markers are never accepted. Anyway, nBits
+     * should be lower than getMinDistance()/2 to avoid wrong ids.
+     */
+    void setMaxCorrectionBits(int nBits) throw (cv::Exception);
+
+    /**
+     */
+    int getMaxCorrectionBits()const
+    {
+      return _maxCorrection;
+    }
+
+    /**Creates a dictionary in which each row of the markers is one of the words passed, and all
+     * the combinations of words are valid markers. The id of a marker is the number, in base
+     * rowWords.size(), formed by the indices of the words of its rows (the first row is the most
+     * significant digit). The markers of the library are such a dictionary, with four words of 5
+     * bits, each one encoding 2 bits of the id.
+     * @param gridSize number of bits of each side of the markers [2,8]
+     * @param rowWords words of gridSize bits. The first bit of the row is the most significant one
+     * @param borderWidth number of cells of the black border around the bits [1,3]
+     */
+    static Dictionary createRowCode(int gridSize,const std::vector<uint64> &rowWords,
+      int borderWidth=1) throw (cv::Exception);
+
+    /**Returns the dictionary of the 1024 markers of the library (see FiducidalMarkers). Ids are
+     * the same
+     */
+    static const Dictionary & getArucoDictionary();
+
+  private:
+
+    //reads the bits of a binary canonical image. Returns false if the border is not black
+    template<int N>
+    bool readBits(const cv::Mat &binary,uint64 &bits)const;
+
+    //identification with errors in row codes
+    int identifyRows(uint64 bits,int &nRotations)const;
+
+    //identification with errors using _correctionIndex
+    int identifyCorrecting(uint64 bits,int &nRotations)const;
+
+    //adds to _correctionIndex the codewords obtained changing up to _maxCorrection bits of code.
+    //Only the bits from firstBit are changed. dist is the number of bits already changed
+    void addCorrections(uint64 code,int pos,int firstBit,int dist);
+
+    int _gridSize,_borderWidth;
+    std::vector<uint64> _codes;     //4 rotations of each marker consecutively
+    std::vector<std::pair<uint64,int> > _index; //codes sorted, with their position in _codes
+    mutable int _minDistance;       //-1 if not calculated. Written by getMinDistance()const
+    int _maxCorrection;             //max number of bits corrected
+    std::vector<uint64> _rowWords;  //words of the rows in row codes. Empty otherwise
+    std::vector<int> _rowNearest,_rowDist; //nearest word to each possible row (-1 if there are
+                                    //several) and distance
+    std::vector<std::pair<uint64,int> > _correctionIndex; //codewords with errors. The int is
+                                    //the position in _codes (<<4) and the number of errors
+};
+
+}
+
+#endif
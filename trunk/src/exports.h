@@ -42,5 +42,10 @@ or implied, of Rafael Muñoz Salinas.
 #define ARUCO_EXPORTS
 #endif
 
+//move constructors and assignments are declared when the compiler supports them
+#if __cplusplus >= 201103L || (defined _MSC_VER && _MSC_VER >= 1600)
+#define ARUCO_HAS_MOVE
+#endif
+
 
 #endif
@@ -0,0 +1,143 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "mappedfile.h"
+#if defined WIN32 || defined _WIN32 || defined WINCE
+#include <windows.h>
+#define ARUCO_WIN32_MAPPING
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+namespace aruco
+{
+
+/*!
+ *  
+ */
+MappedFile::MappedFile()
+{
+  _data=0;
+  _size=0;
+  _isOpen=false;
+  _mapping=0;
+}
+
+/*!
+ *  
+ */
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+/*!
+ *  
+ */
+void MappedFile::open(const string &path) throw (cv::Exception)
+{
+  close();
+#ifdef ARUCO_WIN32_MAPPING
+  HANDLE file=CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE,NULL,
+    OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+  if (file==INVALID_HANDLE_VALUE)
+    throw cv::Exception(9001,"could not open file:"+path,"MappedFile::open",__FILE__,__LINE__);
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file,&size))
+  {
+    CloseHandle(file);
+    throw cv::Exception(9001,"could not read the size of:"+path,"MappedFile::open",
+      __FILE__,__LINE__);
+  }
+  _size=size_t(size.QuadPart);
+  if (_size>0)
+  {
+    HANDLE mapping=CreateFileMapping(file,NULL,PAGE_READONLY,0,0,NULL);
+    if (mapping!=NULL)
+      _data=(const unsigned char*)MapViewOfFile(mapping,FILE_MAP_READ,0,0,_size);
+    if (_data==0)
+    {
+      if (mapping!=NULL) CloseHandle(mapping);
+      CloseHandle(file);
+      throw cv::Exception(9001,"could not map file:"+path,"MappedFile::open",__FILE__,__LINE__);
+    }
+    _mapping=mapping;
+  }
+  //the mapping keeps the file open
+  CloseHandle(file);
+#else
+  int fd=::open(path.c_str(),O_RDONLY);
+  if (fd<0)
+    throw cv::Exception(9001,"could not open file:"+path,"MappedFile::open",__FILE__,__LINE__);
+  struct stat st;
+  if (fstat(fd,&st)!=0)
+  {
+    ::close(fd);
+    throw cv::Exception(9001,"could not read the size of:"+path,"MappedFile::open",
+      __FILE__,__LINE__);
+  }
+  _size=size_t(st.st_size);
+  if (_size>0)
+  {
+    void *p=mmap(0,_size,PROT_READ,MAP_SHARED,fd,0);
+    if (p==MAP_FAILED)
+    {
+      ::close(fd);
+      throw cv::Exception(9001,"could not map file:"+path,"MappedFile::open",__FILE__,__LINE__);
+    }
+    _data=(const unsigned char*)p;
+  }
+  //the mapping keeps the file open
+  ::close(fd);
+#endif
+  _isOpen=true;
+}
+
+/*!
+ *  
+ */
+void MappedFile::close()
+{
+  if (_data!=0)
+  {
+#ifdef ARUCO_WIN32_MAPPING
+    UnmapViewOfFile(_data);
+    CloseHandle((HANDLE)_mapping);
+#else
+    munmap((void*)_data,_size);
+#endif
+  }
+  _data=0;
+  _size=0;
+  _mapping=0;
+  _isOpen=false;
+}
+
+}
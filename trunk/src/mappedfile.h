@@ -0,0 +1,88 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_MappedFile_H
+#define _ARUCO_MappedFile_H
+#include <opencv2/core/core.hpp>
+#include <string>
+#include "exports.h"
+namespace aruco
+{
+
+/**\brief Read-only memory mapping of a file (mmap or the Win32 API)
+ */
+class ARUCO_EXPORTS MappedFile
+{
+  public:
+
+    MappedFile();
+    ~MappedFile();
+
+    /**Maps the whole file. A previous mapping is released
+     */
+    void open(const std::string &path) throw (cv::Exception);
+
+    /**Releases the mapping
+     */
+    void close();
+
+    /**
+     */
+    bool isOpen()const
+    {
+      return _isOpen;
+    }
+
+    /**Content of the file. NULL if the file is empty
+     */
+    const unsigned char * data()const
+    {
+      return _data;
+    }
+
+    /**Size of the file when it was mapped
+     */
+    size_t size()const
+    {
+      return _size;
+    }
+
+  private:
+
+    //not copyable
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+
+    const unsigned char *_data;
+    size_t _size;
+    bool _isOpen;
+    void *_mapping; //handle of the mapping in Win32
+};
+
+}
+
+#endif
@@ -29,6 +29,7 @@ or implied, of Rafael Muñoz Salinas.
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <cstdio>
+#include <algorithm>
 
 using namespace cv;
 namespace aruco
@@ -41,23 +42,30 @@ Marker::Marker()
 {
   id=-1;
   ssize=-1;
-  Rvec.create(3,1,CV_32FC1);
-  Tvec.create(3,1,CV_32FC1);
-  for (int i=0; i<3; i++)
-    Tvec.at<float>(i,0)=Rvec.at<float>(i,0)=-999999;
 }
 
 /*!
  *  
  */
-Marker::Marker(const Marker &M):std::vector<cv::Point2f>(M)
+Marker::Marker(const Marker &M):std::vector<cv::Point2f>(M),Rvec(M.Rvec),Tvec(M.Tvec)
 {
-  M.Rvec.copyTo(Rvec);
-  M.Tvec.copyTo(Tvec);
   id=M.id;
   ssize=M.ssize;
 }
 
+/*!
+ *  
+ */
+void Marker::swap(Marker &M)
+{
+  std::vector<cv::Point2f>::swap(M);
+  std::swap(id,M.id);
+  std::swap(ssize,M.ssize);
+  Rvec.swap(M.Rvec);
+  Tvec.swap(M.Tvec);
+  std::swap(_pose,M._pose);
+}
+
 /*!
  *  
  */
@@ -65,10 +73,6 @@ Marker::Marker(const  std::vector<cv::Point2f> &corners,int _id):std::vector<cv:
 {
   id=_id;
   ssize=-1;
-  Rvec.create(3,1,CV_32FC1);
-  Tvec.create(3,1,CV_32FC1);
-  for (int i=0; i<3; i++)
-    Tvec.at<float>(i,0)=Rvec.at<float>(i,0)=-999999;
 }
 
 /*!
@@ -88,45 +92,8 @@ void Marker::glGetModelViewMatrix(   double modelview_matrix[16])throw(cv::Excep
     throw cv::Exception(9003,"extrinsic parameters are not set","Marker::getModelViewMatrix",
       __FILE__,__LINE__);
 
-  Mat Rot(3,3,CV_32FC1),Jacob;
-  Rodrigues(Rvec, Rot, Jacob);
-
-  double para[3][4];
-  for (int i=0; i<3; i++)
-    for (int j=0; j<3; j++) para[i][j]=Rot.at<float>(i,j);
-  //now, add the translation
-  para[0][3]=Tvec.at<float>(0,0);
-  para[1][3]=Tvec.at<float>(1,0);
-  para[2][3]=Tvec.at<float>(2,0);
-  double scale=1;
-
-  modelview_matrix[0 + 0*4] = para[0][0];
-  // R1C2
-  modelview_matrix[0 + 1*4] = para[0][1];
-  modelview_matrix[0 + 2*4] = para[0][2];
-  modelview_matrix[0 + 3*4] = para[0][3];
-  // R2
-  modelview_matrix[1 + 0*4] = para[1][0];
-  modelview_matrix[1 + 1*4] = para[1][1];
-  modelview_matrix[1 + 2*4] = para[1][2];
-  modelview_matrix[1 + 3*4] = para[1][3];
-  // R3
-  modelview_matrix[2 + 0*4] = -para[2][0];
-  modelview_matrix[2 + 1*4] = -para[2][1];
-  modelview_matrix[2 + 2*4] = -para[2][2];
-  modelview_matrix[2 + 3*4] = -para[2][3];
-  modelview_matrix[3 + 0*4] = 0.0;
-  modelview_matrix[3 + 1*4] = 0.0;
-  modelview_matrix[3 + 2*4] = 0.0;
-  modelview_matrix[3 + 3*4] = 1.0;
-  if (scale != 0.0)
-  {
-    modelview_matrix[12] *= scale;
-    modelview_matrix[13] *= scale;
-    modelview_matrix[14] *= scale;
-  }
-
-
+  _pose.update(Rvec,Tvec);
+  _pose.glGetModelViewMatrix(modelview_matrix);
 }
 
 /*!
@@ -146,79 +113,8 @@ void Marker::OgreGetPoseParameters(double position[3], double orientation[4]) th
     throw cv::Exception(9003,"extrinsic parameters are not set","Marker::getModelViewMatrix",
       __FILE__,__LINE__);
 
-  // calculate position vector
-  position[0] = -Tvec.ptr<float>(0)[0];
-  position[1] = -Tvec.ptr<float>(0)[1];
-  position[2] = +Tvec.ptr<float>(0)[2];
-
-  // now calculare orientation quaternion
-  Mat Rot(3,3,CV_32FC1);
-  Rodrigues(Rvec, Rot);
-
-  // calculate axes for quaternion
-  double stAxes[3][3];
-  // x axis
-  stAxes[0][0] = -Rot.at<float>(0,0);
-  stAxes[0][1] = -Rot.at<float>(1,0);
-  stAxes[0][2] = +Rot.at<float>(2,0);
-  // y axis
-  stAxes[1][0] = -Rot.at<float>(0,1);
-  stAxes[1][1] = -Rot.at<float>(1,1);
-  stAxes[1][2] = +Rot.at<float>(2,1);
-  // for z axis, we use cross product
-  stAxes[2][0] = stAxes[0][1]*stAxes[1][2] - stAxes[0][2]*stAxes[1][1];
-  stAxes[2][1] = - stAxes[0][0]*stAxes[1][2] + stAxes[0][2]*stAxes[1][0];
-  stAxes[2][2] = stAxes[0][0]*stAxes[1][1] - stAxes[0][1]*stAxes[1][0];
-
-  // transposed matrix
-  double axes[3][3];
-  axes[0][0] = stAxes[0][0];
-  axes[1][0] = stAxes[0][1];
-  axes[2][0] = stAxes[0][2];
-
-  axes[0][1] = stAxes[1][0];
-  axes[1][1] = stAxes[1][1];
-  axes[2][1] = stAxes[1][2];
-
-  axes[0][2] = stAxes[2][0];
-  axes[1][2] = stAxes[2][1];
-  axes[2][2] = stAxes[2][2];
-
-  // Algorithm in Ken Shoemake's article in 1987 SIGGRAPH course notes
-  // article "Quaternion Calculus and Fast Animation".
-  double fTrace = axes[0][0]+axes[1][1]+axes[2][2];
-  double fRoot;
-
-  if ( fTrace > 0.0 )
-  {
-    // |w| > 1/2, may as well choose w > 1/2
-    fRoot = sqrt(fTrace + 1.0);  // 2w
-    orientation[0] = 0.5*fRoot;
-    fRoot = 0.5/fRoot;  // 1/(4w)
-    orientation[1] = (axes[2][1]-axes[1][2])*fRoot;
-    orientation[2] = (axes[0][2]-axes[2][0])*fRoot;
-    orientation[3] = (axes[1][0]-axes[0][1])*fRoot;
-  }
-  else
-  {
-    // |w| <= 1/2
-    static unsigned int s_iNext[3] = { 1, 2, 0 };
-    unsigned int i = 0;
-    if ( axes[1][1] > axes[0][0] )
-      i = 1;
-    if ( axes[2][2] > axes[i][i] )
-      i = 2;
-    unsigned int j = s_iNext[i];
-    unsigned int k = s_iNext[j];
-
-    fRoot = sqrt(axes[i][i]-axes[j][j]-axes[k][k] + 1.0);
-    double* apkQuat[3] = { &orientation[1], &orientation[2], &orientation[3] };
-    *apkQuat[i] = 0.5*fRoot;
-    fRoot = 0.5/fRoot;
-    orientation[0] = (axes[k][j]-axes[j][k])*fRoot;
-    *apkQuat[j] = (axes[j][i]+axes[i][j])*fRoot;
-    *apkQuat[k] = (axes[k][i]+axes[i][k])*fRoot;
-  }
+  _pose.update(Rvec,Tvec);
+  _pose.OgreGetPoseParameters(position,orientation);
 }
 
 /*!
@@ -265,7 +161,18 @@ void Marker::calculateExtrinsics(float markerSize,const CameraParameters &CP,
   if (!CP.isValid())
     throw cv::Exception(9004,"!CP.isValid(): invalid camera parameters. It is not possible to "
       "calculate extrinsics","calculateExtrinsics",__FILE__,__LINE__);
-  calculateExtrinsics( markerSize,CP.CameraMatrix,CP.Distorsion,setYPerperdicular);
+  if (CP.DistorsionModel==CameraParameters::FISHEYE)
+  {
+    //OpenCV does not know the model, so the pose is calculated with the undistorted corners
+    Marker ideal(*this);
+    CP.undistortPoints(*this,ideal);
+    ideal.calculateExtrinsics(markerSize,CP.CameraMatrix,CP.getOpenCVDistorsion(),
+      setYPerperdicular);
+    Rvec=ideal.Rvec;
+    Tvec=ideal.Tvec;
+    ssize=ideal.ssize;
+  }
+  else calculateExtrinsics( markerSize,CP.CameraMatrix,CP.Distorsion,setYPerperdicular);
 }
 
 //void print(cv::Point3f p,string cad)
@@ -32,6 +32,8 @@ or implied, of Rafael Muñoz Salinas.
 #include <opencv2/opencv.hpp>
 #include "exports.h"
 #include "cameraparameters.h"
+#include "posecache.h"
+#include "posevector.h"
 using namespace std;
 namespace aruco
 {
@@ -46,8 +48,8 @@ class  ARUCO_EXPORTS Marker: public std::vector<cv::Point2f>
     int id;
     //size of the markers sides in meters
     float ssize;
-    //matrices of rotation and translation respect to the camera
-    cv::Mat Rvec,Tvec;
+    //matrices of rotation and translation respect to the camera (3x1 CV_32FC1, see PoseVector)
+    PoseVector Rvec,Tvec;
 
     /**
      */
@@ -57,6 +59,39 @@ class  ARUCO_EXPORTS Marker: public std::vector<cv::Point2f>
      */
     Marker(const Marker &M);
 
+#ifdef ARUCO_HAS_MOVE
+    /**Move constructor
+     */
+    Marker(Marker &&M):id(-1),ssize(-1)
+    {
+      swap(M);
+    }
+
+    /**Move assignment
+     */
+    Marker & operator=(Marker &&M)
+    {
+      swap(M);
+      return *this;
+    }
+
+    /**Copy assignment (declared since the move operations are)
+     */
+    Marker & operator=(const Marker &M)
+    {
+      std::vector<cv::Point2f>::operator=(M);
+      id=M.id;
+      ssize=M.ssize;
+      Rvec=M.Rvec;
+      Tvec=M.Tvec;
+      return *this;
+    }
+#endif
+
+    /**Exchanges the content with the marker passed, without copying the corners
+     */
+    void swap(Marker &M);
+
     /**
      */
     Marker(const  std::vector<cv::Point2f> &corners,int _id=-1);
@@ -88,7 +123,8 @@ class  ARUCO_EXPORTS Marker: public std::vector<cv::Point2f>
     /**Calculates the extrinsics (Rvec and Tvec) of the marker with respect to the camera
      * @param markerSize size of the marker side expressed in meters
      * @param CameraMatrix matrix with camera parameters (fx,fy,cx,cy)
-     * @param Distorsion matrix with distorsion parameters (k1,k2,p1,p2)
+     * @param Distorsion matrix with distorsion parameters (4, 5 or 8 coefficients, see
+     * CameraParameters)
      * @param setYPerperdicular If set the Y axis will be perpendicular to the surface.
      * Otherwise, it will be the Z axis
      */
@@ -149,6 +185,8 @@ class  ARUCO_EXPORTS Marker: public std::vector<cv::Point2f>
     }
 
   private:
+    PoseCache _pose;//rotation matrix and quaternion of Rvec,Tvec for the GL/Ogre accessors
+
     void rotateXAxis(cv::Mat &rotation);
 
 };
@@ -0,0 +1,177 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "markerarrays.h"
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+namespace
+{
+
+/*!
+ * Appends the 3 values of a pose vector (-999999 if it is not a 3 elements vector)
+ */
+void appendPoseVector(const Mat &v,vector<float> &out)
+{
+  if (v.total()==3 && v.type()==CV_32FC1 && v.isContinuous())
+  {
+    const float *p=v.ptr<float>(0);
+    out.insert(out.end(),p,p+3);
+  }
+  else if (v.total()==3 && v.channels()==1)
+  {
+    Mat f;
+    v.reshape(1,3).convertTo(f,CV_32F);
+    for (int i=0; i<3; i++) out.push_back(f.at<float>(i));
+  }
+  else out.insert(out.end(),3,-999999.f);
+}
+
+}
+
+/*!
+ *  
+ */
+MarkerArrays::MarkerArrays()
+{
+}
+
+/*!
+ *  
+ */
+MarkerArrays::MarkerArrays(const vector<Marker> &markers)
+{
+  assign(markers);
+}
+
+/*!
+ *  
+ */
+void MarkerArrays::clear()
+{
+  _ids.clear();
+  _corners.clear();
+  _rvecs.clear();
+  _tvecs.clear();
+  _sizes.clear();
+  _perimeters.clear();
+  _areas.clear();
+}
+
+/*!
+ *  
+ */
+void MarkerArrays::reserve(size_t n)
+{
+  _ids.reserve(n);
+  _corners.reserve(4*n);
+  _rvecs.reserve(3*n);
+  _tvecs.reserve(3*n);
+  _sizes.reserve(n);
+  _perimeters.reserve(n);
+  _areas.reserve(n);
+}
+
+/*!
+ *  
+ */
+void MarkerArrays::push_back(const Marker &m)throw(cv::Exception)
+{
+  if (m.size()!=4)
+    throw cv::Exception(9001,"markers must have 4 corners","MarkerArrays::push_back",
+      __FILE__,__LINE__);
+  _ids.push_back(m.id);
+  _corners.insert(_corners.end(),m.begin(),m.end());
+  appendPoseVector(m.Rvec,_rvecs);
+  appendPoseVector(m.Tvec,_tvecs);
+  _sizes.push_back(m.ssize);
+  _perimeters.push_back(m.getPerimeter());
+  _areas.push_back(m.getArea());
+}
+
+/*!
+ *  
+ */
+void MarkerArrays::assign(const vector<Marker> &markers)throw(cv::Exception)
+{
+  clear();
+  reserve(markers.size());
+  for (size_t i=0; i<markers.size(); i++)
+    push_back(markers[i]);
+}
+
+/*!
+ *  
+ */
+void MarkerArrays::copyTo(vector<Marker> &markers)const
+{
+  markers.resize(size());
+  for (size_t i=0; i<size(); i++)
+  {
+    Marker &m=markers[i];
+    m.assign(_corners.begin()+4*i,_corners.begin()+4*i+4);
+    m.id=_ids[i];
+    m.ssize=_sizes[i];
+    m.Rvec=Mat(3,1,CV_32FC1,(void*)&_rvecs[3*i]);
+    m.Tvec=Mat(3,1,CV_32FC1,(void*)&_tvecs[3*i]);
+  }
+}
+
+/*!
+ *  
+ */
+Marker MarkerArrays::getMarker(size_t i)const
+{
+  Marker m(vector<Point2f>(_corners.begin()+4*i,_corners.begin()+4*i+4),_ids[i]);
+  m.ssize=_sizes[i];
+  m.Rvec=Mat(3,1,CV_32FC1,(void*)&_rvecs[3*i]);
+  m.Tvec=Mat(3,1,CV_32FC1,(void*)&_tvecs[3*i]);
+  return m;
+}
+
+/*!
+ *  
+ */
+int MarkerArrays::find(int id)const
+{
+  for (size_t i=0; i<_ids.size(); i++)
+    if (_ids[i]==id) return i;
+  return -1;
+}
+
+/*!
+ *  
+ */
+Mat MarkerArrays::getCornersMat()const
+{
+  if (empty()) return Mat();
+  return Mat(size(),8,CV_32FC1,(void*)&_corners[0]);
+}
+
+}
@@ -0,0 +1,141 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_MarkerArrays_H
+#define _ARUCO_MarkerArrays_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "exports.h"
+#include "marker.h"
+namespace aruco
+{
+
+/**\brief Detected markers stored as parallel arrays.
+ *
+ * Alternative to std::vector<Marker> for consumers that process many detections. The data of
+ * all the markers is kept in flat arrays (ids, 4 corners per marker, poses and quality metrics),
+ * so iterating over one of them does not touch the others nor chase a pointer per marker.
+ * clear() keeps the memory, so an object reused across frames does not allocate once it has
+ * grown to the number of markers usually seen.
+ *
+ * Marker i has its corners in getCorners()[4*i .. 4*i+3], its rotation and translation vectors
+ * in getRvecs()[3*i .. 3*i+2] and getTvecs()[3*i .. 3*i+2] (-999999 if not calculated).
+ */
+class ARUCO_EXPORTS MarkerArrays
+{
+  public:
+
+    /**Creates an empty object
+     */
+    MarkerArrays();
+
+    /**Creates the arrays from the markers passed
+     */
+    MarkerArrays(const std::vector<Marker> &markers);
+
+    /**Removes all the markers, keeping the memory reserved
+     */
+    void clear();
+
+    /**Reserves memory for n markers
+     */
+    void reserve(size_t n);
+
+    /**Number of markers
+     */
+    size_t size()const {return _ids.size();}
+
+    /**Indicates whether there is no marker
+     */
+    bool empty()const {return _ids.empty();}
+
+    /**Appends a marker. It must have 4 corners
+     */
+    void push_back(const Marker &m)throw(cv::Exception);
+
+    /**Replaces the content by the markers passed
+     */
+    void assign(const std::vector<Marker> &markers)throw(cv::Exception);
+
+    /**Converts to the usual representation. The vector passed is resized to size()
+     */
+    void copyTo(std::vector<Marker> &markers)const;
+
+    /**Returns the marker i as a Marker object
+     */
+    Marker getMarker(size_t i)const;
+
+    /**Returns the index of the marker with the id indicated, or -1 if not found
+     */
+    int find(int id)const;
+
+    /**Ids of the markers
+     */
+    const int *getIds()const {return empty()?0:&_ids[0];}
+    int *getIds() {return empty()?0:&_ids[0];}
+
+    /**Corners of the markers, 4 per marker (i.e., N x 4 x 2 floats)
+     */
+    const cv::Point2f *getCorners()const {return empty()?0:&_corners[0];}
+    cv::Point2f *getCorners() {return empty()?0:&_corners[0];}
+
+    /**Rotation vectors of the markers, 3 floats per marker
+     */
+    const float *getRvecs()const {return empty()?0:&_rvecs[0];}
+    float *getRvecs() {return empty()?0:&_rvecs[0];}
+
+    /**Translation vectors of the markers, 3 floats per marker
+     */
+    const float *getTvecs()const {return empty()?0:&_tvecs[0];}
+    float *getTvecs() {return empty()?0:&_tvecs[0];}
+
+    /**Size of the markers sides in meters (-1 if unknown)
+     */
+    const float *getSizes()const {return empty()?0:&_sizes[0];}
+
+    /**Perimeter of the markers in pixels
+     */
+    const float *getPerimeters()const {return empty()?0:&_perimeters[0];}
+
+    /**Area of the markers in pixels
+     */
+    const float *getAreas()const {return empty()?0:&_areas[0];}
+
+    /**Returns the corners as a N x 8 CV_32FC1 matrix sharing the data with this object. It is
+     * valid until the object is modified
+     */
+    cv::Mat getCornersMat()const;
+
+  private:
+    std::vector<int> _ids;
+    std::vector<cv::Point2f> _corners;
+    std::vector<float> _rvecs,_tvecs;
+    std::vector<float> _sizes,_perimeters,_areas;
+};
+
+}
+#endif
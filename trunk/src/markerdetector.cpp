@@ -51,9 +51,26 @@ MarkerDetector::MarkerDetector()
   _markerWarpSize=56;
   _speed=0;
   markerIdDetector_ptrfunc=aruco::FiducidalMarkers::detect;
+  _useDictionary=false;
   pyrdown_level=0; // no image reduction
   _minSize=0.04;
   _maxSize=0.5;
+  _nStripes=1;
+  _coarseToFine=false;
+  _userPyrLevel=pyrdown_level;
+  _userMinSize=_minSize;
+  _userMaxSize=_maxSize;
+  _autoTuning=false;
+  _tuneMinSide=20;
+  _tuneFramesToReset=5;
+  _tuneFramesLost=0;
+  _timeBudget=-1;
+  _priority=PRIORITY_AREA;
+  _partial=false;
+  _candidateScoring=false;
+  _scoreMinEdgeContrast=_scoreMinInteriorContrast=15;
+  _scoreMinSideRatio=0.2;
+  _scoreMaxCos=0.8;
 }
 
 /*!
@@ -97,8 +114,37 @@ void MarkerDetector::detect (const cv::Mat &input, std::vector<Marker> &detected
   CameraParameters camParams ,float markerSizeMeters ,bool setYPerperdicular)
   throw (cv::Exception)
 {
-  detect (input, detectedMarkers, camParams.CameraMatrix, camParams.Distorsion,
-    markerSizeMeters ,setYPerperdicular);
+  if (camParams.DistorsionModel!=CameraParameters::FISHEYE)
+  {
+    detect (input, detectedMarkers, camParams.CameraMatrix, camParams.Distorsion,
+      markerSizeMeters ,setYPerperdicular);
+    return;
+  }
+  //the pose is calculated by the markers, that undistort their corners with the fisheye model
+  detect (input, detectedMarkers);
+  if (camParams.isValid() && markerSizeMeters>0)
+    for (unsigned int i=0; i<detectedMarkers.size(); i++ )
+      detectedMarkers[i].calculateExtrinsics(markerSizeMeters,camParams,setYPerperdicular);
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::detect (const cv::Mat &input,MarkerArrays &detectedMarkers,Mat camMatrix,
+  Mat distCoeff,float markerSizeMeters,bool setYPerperdicular) throw (cv::Exception)
+{
+  detect (input,_arraysMarkers,camMatrix,distCoeff,markerSizeMeters,setYPerperdicular);
+  detectedMarkers.assign (_arraysMarkers);
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::detect (const cv::Mat &input,MarkerArrays &detectedMarkers,
+  CameraParameters camParams,float markerSizeMeters,bool setYPerperdicular) throw (cv::Exception)
+{
+  detect (input,_arraysMarkers,camParams,markerSizeMeters,setYPerperdicular);
+  detectedMarkers.assign (_arraysMarkers);
 }
 
 /*!
@@ -107,6 +153,10 @@ void MarkerDetector::detect (const cv::Mat &input, std::vector<Marker> &detected
 void MarkerDetector::detect (const cv::Mat &input, vector<Marker> &detectedMarkers, Mat camMatrix,
   Mat distCoeff ,float markerSizeMeters ,bool setYPerperdicular) throw (cv::Exception)
 {
+  //the deadline is counted from the very beginning
+  int64 deadline=cv::getTickCount()+int64(_timeBudget*cv::getTickFrequency()/1000.);
+  _partial=false;
+
   //it must be a 3 channel image
   if (input.type()==CV_8UC3)
     cv::cvtColor ( input,grey,CV_BGR2GRAY );
@@ -120,36 +170,39 @@ void MarkerDetector::detect (const cv::Mat &input, vector<Marker> &detectedMarke
 
   cv::Mat imgToBeThresHolded=grey;
   double ThresParam1=_thresParam1,ThresParam2=_thresParam2;
+  //in coarse to fine mode, the markers are identified in the reduced image
+  bool coarseToFine=_coarseToFine && pyrdown_level!=0;
   //Must the image be downsampled before continue processing?
   if ( pyrdown_level!=0 )
   {
-    reduced=grey;
-    for ( int i=0; i<pyrdown_level; i++ )
-    {
-      cv::Mat tmp;
-      cv::pyrDown ( reduced,tmp );
-      reduced=tmp;
-    }
+    //the levels are kept so that their memory is reused in the next calls
+    cv::buildPyramid ( grey,_pyramid,pyrdown_level );
+    reduced=_pyramid[pyrdown_level];
     int red_den=pow ( 2.0f,pyrdown_level );
     imgToBeThresHolded=reduced;
     ThresParam1/=float ( red_den );
     ThresParam2/=float ( red_den );
   }
 
-  ///Do threshold the image and detect contours
-  thresHold ( _thresMethod,imgToBeThresHolded,thres,ThresParam1,ThresParam2 );
-  //an erosion might be required to detect chessboard like boards
-  if ( _doErosion )
+  vector<MarkerCandidate > MarkerCanditates;
+  if ( _nStripes>1 )
+    detectRectanglesStriped ( imgToBeThresHolded,ThresParam1,ThresParam2,MarkerCanditates );
+  else
   {
-    erode ( thres,thres2,cv::Mat() );
-    thres2.copyTo(thres); //vs thres=thres2;
+    ///Do threshold the image and detect contours
+    thresHold ( _thresMethod,imgToBeThresHolded,thres,ThresParam1,ThresParam2 );
+    //an erosion might be required to detect chessboard like boards
+    if ( _doErosion )
+    {
+      erode ( thres,thres2,cv::Mat() );
+      thres2.copyTo(thres); //vs thres=thres2;
+    }
+    //find all rectangles in the thresholdes image
+    detectRectangles ( thres,MarkerCanditates );
   }
-  //find all rectangles in the thresholdes image
-  vector<MarkerCandidate > MarkerCanditates;
-  detectRectangles ( thres,MarkerCanditates );
   //if the image has been down sampled, then calculate the location of the corners in the original
   //image
-  if ( pyrdown_level!=0 )
+  if ( pyrdown_level!=0 && !coarseToFine )
   {
     float red_den=pow ( 2.0f,pyrdown_level );
     float offInc= ( ( pyrdown_level/2. )-0.5 );
@@ -170,41 +223,96 @@ void MarkerDetector::detect (const cv::Mat &input, vector<Marker> &detectedMarke
   }
 
   ///identify the markers
+  if ( _timeBudget>0 )
+    sortCandidatesByPriority ( MarkerCanditates,coarseToFine?pow ( 2.0f,pyrdown_level ) :1.f );
+  cv::Mat imgToBeWarped=coarseToFine?reduced:grey;
   _candidates.clear();
-  for ( unsigned int i=0; i<MarkerCanditates.size(); i++ )
+  vector<int> identified,rotations;//candidates with valid id and their rotations
+  //ids found: -1 no valid id, -2 not analyzed (time budget), -3 not warped
+  int nCandidates=MarkerCanditates.size();
+  vector<int> ids ( nCandidates,-2 ),nRotations ( nCandidates,0 );
+  //candidates are analyzed in parallel if USE_OMP is defined. The dynamic schedule keeps the
+  //priority order when there is a time budget
+#ifdef USE_OMP
+#pragma omp parallel
+#endif
   {
-    //Find proyective homography
+    //buffers reused by all the candidates of the thread
     Mat canonicalMarker;
-    bool resW=false;
-    if (_enableCylinderWarp)
-      resW=warp_cylinder(grey, canonicalMarker, Size(_markerWarpSize, _markerWarpSize),
-        MarkerCanditates[i] );
-    else 
-      resW=warp(grey, canonicalMarker, Size(_markerWarpSize,_markerWarpSize), MarkerCanditates[i]);
-    if (resW)
+    vector<int> rowStart;
+#ifdef USE_OMP
+#pragma omp for schedule(dynamic)
+#endif
+    for ( int i=0; i<nCandidates; i++ )
     {
-      int nRotations;
-      int id= ( *markerIdDetector_ptrfunc ) ( canonicalMarker,nRotations );
-      if (id!=-1)
+      if ( _timeBudget>0 && cv::getTickCount() >deadline )
+        continue;
+      //discard the hopeless candidates before warping
+      if ( _candidateScoring && !scoreCandidate ( imgToBeWarped,MarkerCanditates[i] ) )
       {
-        if (_cornerMethod==LINES)
-          refineCandidateLines( MarkerCanditates[i] );
-          // make LINES refinement before lose contour points
-
-        detectedMarkers.push_back ( MarkerCanditates[i] );
-        detectedMarkers.back().id=id;
-        //sort the points so that they are always in the same order no matter the camera orientation
-        std::rotate (detectedMarkers.back().begin(), detectedMarkers.back().begin()+4-nRotations,
-          detectedMarkers.back().end() );
+        ids[i]=-1;
+        continue;
       }
+      //Find proyective homography
+      bool resW=false;
+      if (_enableCylinderWarp)
+        resW=warp_cylinder(imgToBeWarped, canonicalMarker, Size(_markerWarpSize, _markerWarpSize),
+          MarkerCanditates[i],rowStart );
       else
-        _candidates.push_back ( MarkerCanditates[i] );
+        resW=warp(imgToBeWarped, canonicalMarker, Size(_markerWarpSize,_markerWarpSize),
+          MarkerCanditates[i]);
+      if (resW)
+        ids[i]=_useDictionary?_dictionary.detect ( canonicalMarker,nRotations[i] ) :
+          ( *markerIdDetector_ptrfunc ) ( canonicalMarker,nRotations[i] );
+      else
+        ids[i]=-3;
+    }
+  }
+  for ( int i=0; i<nCandidates; i++ )
+  {
+    if ( ids[i]==-2 )
+      _partial=true;
+    else if ( ids[i]>=0 )
+    {
+      MarkerCanditates[i].id=ids[i];
+      identified.push_back ( i );
+      rotations.push_back ( nRotations[i] );
+    }
+    else if ( ids[i]==-1 )
+    {
+      //the rejected candidates are not employed anymore, so that their corners are taken
+      _candidates.push_back ( vector<Point2f>() );
+      _candidates.back().swap ( MarkerCanditates[i] );
     }
+  }
 
+  // make LINES refinement before lose contour points. All markers at once
+  if (_cornerMethod==LINES)
+    refineCandidatesLines ( MarkerCanditates,identified );
+  detectedMarkers.reserve ( identified.size() );
+  for ( size_t i=0; i<identified.size(); i++ )
+  {
+    detectedMarkers.push_back ( Marker() );
+    detectedMarkers.back().swap ( MarkerCanditates[identified[i]] );
+    //sort the points so that they are always in the same order no matter the camera orientation
+    std::rotate (detectedMarkers.back().begin(), detectedMarkers.back().begin()+4-rotations[i],
+      detectedMarkers.back().end() );
   }
 
+  ///go up in the pyramid refining the corners in each level
+  if ( coarseToFine )
+  {
+    refineCornersCoarseToFine ( detectedMarkers );
+    //the rejected candidates must be also expressed in the original image
+    float red_den=pow ( 2.0f,pyrdown_level );
+    for (size_t i=0; i<_candidates.size(); i++ )
+      for (size_t c=0; c<_candidates[i].size(); c++ )
+        _candidates[i][c]*=red_den;
+  }
   ///refine the corner location if desired
-  if ( detectedMarkers.size() >0 && _cornerMethod!=NONE && _cornerMethod!=LINES )
+  else if ( _cornerMethod==EDGES )
+    refineCornersEdges ( grey,detectedMarkers );
+  else if ( detectedMarkers.size() >0 && _cornerMethod!=NONE && _cornerMethod!=LINES )
   {
     vector<Point2f> Corners;
     for (unsigned int i=0; i<detectedMarkers.size(); i++ )
@@ -244,6 +352,15 @@ void MarkerDetector::detect (const cv::Mat &input, vector<Marker> &detectedMarke
   //remove the markers marker
   removeElements ( detectedMarkers, toRemove );
 
+  //keep the location of the markers to give priority to the candidates near them
+  _prevCenters.resize ( detectedMarkers.size() );
+  for (unsigned int i=0; i<detectedMarkers.size(); i++ )
+    _prevCenters[i]=detectedMarkers[i].getCenter();
+
+  //prepare the level and sizes for the next frame
+  if ( _autoTuning )
+    updateAutoTuning ( detectedMarkers,grey.size() );
+
   //detect the position of detected markers if desired
   if ( camMatrix.rows!=0  && markerSizeMeters>0 )
   {
@@ -264,7 +381,7 @@ void MarkerDetector::detectRectangles(const cv::Mat &thres,
   //create the output
   MarkerCanditates.resize(candidates.size());
   for (size_t i=0; i<MarkerCanditates.size(); i++)
-    MarkerCanditates[i]=candidates[i];
+    MarkerCanditates[i].swap(candidates[i]);
 }
 
 /*!
@@ -273,15 +390,25 @@ void MarkerDetector::detectRectangles(const cv::Mat &thres,
 void MarkerDetector::detectRectangles(const cv::Mat &thresImg,
   vector<MarkerCandidate> & OutMarkerCanditates)
 {
-  vector<MarkerCandidate>  MarkerCanditates;
   //calculate the min_max contour sizes
   unsigned int minSize=_minSize*std::max(thresImg.cols,thresImg.rows)*4;
   unsigned int maxSize=_maxSize*std::max(thresImg.cols,thresImg.rows)*4;
+  vector<MarkerCandidate>  MarkerCanditates;
+  thresImg.copyTo ( thres2 );
+  findQuads ( thres2,MarkerCanditates,minSize,maxSize );
+  filterQuads ( MarkerCanditates,OutMarkerCanditates );
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::findQuads(cv::Mat &thresImg, vector<MarkerCandidate> & MarkerCanditates,
+  unsigned int minSize, unsigned int maxSize, cv::Point offset)
+{
   std::vector<std::vector<cv::Point> > contours2;
   std::vector<cv::Vec4i> hierarchy2;
 
-  thresImg.copyTo ( thres2 );
-  cv::findContours ( thres2 , contours2, hierarchy2,CV_RETR_TREE, CV_CHAIN_APPROX_NONE );
+  cv::findContours ( thresImg , contours2, hierarchy2,CV_RETR_TREE, CV_CHAIN_APPROX_NONE, offset );
   vector<Point>  approxCurve;
   ///for each contour, analyze if it is a paralelepiped likely to be the marker
 
@@ -326,11 +453,22 @@ void MarkerDetector::detectRectangles(const cv::Mat &thresImg,
             MarkerCanditates.back().idx=i;
             for ( int j=0; j<4; j++ )
               MarkerCanditates.back().push_back ( Point2f ( approxCurve[j].x,approxCurve[j].y ) );
+            //contours2 is not used anymore, so that the points can be taken instead of copied
+            //the corners are located in the contour later, only for the markers refined by LINES
+            MarkerCanditates.back().contour.swap ( contours2[i] );
           }
         }
       }
     }
   }
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::filterQuads(vector<MarkerCandidate> & MarkerCanditates,
+  vector<MarkerCandidate> & OutMarkerCanditates)
+{
 
 //          namedWindow("input");
 //      imshow("input",input);
@@ -351,6 +489,7 @@ void MarkerDetector::detectRectangles(const cv::Mat &thresImg,
     if ( o  < 0.0 )    //if the third point is in the left side, then sort in anti-clockwise order
     {
       swap ( MarkerCanditates[i][1],MarkerCanditates[i][3] );
+      swap ( MarkerCanditates[i].cornerIdx[1],MarkerCanditates[i].cornerIdx[3] );
       swapped[i]=true;
       //sort the contour points
 //        reverse(MarkerCanditates[i].contour.begin(),MarkerCanditates[i].contour.end());//????
@@ -406,18 +545,101 @@ void MarkerDetector::detectRectangles(const cv::Mat &thresImg,
   {
     if (!toRemove[i])
     {
-      OutMarkerCanditates.push_back(MarkerCanditates[i]);
-      OutMarkerCanditates.back().contour=contours2[ MarkerCanditates[i].idx];
+      OutMarkerCanditates.push_back(MarkerCandidate());
+      OutMarkerCanditates.back().swap(MarkerCanditates[i]);
 
       //if the corners where swapped, it is required to reverse here the points so that
       //they are in the same order
       if (swapped[i] && _enableCylinderWarp )
-        reverse(OutMarkerCanditates.back().contour.begin(),
-          OutMarkerCanditates.back().contour.end());//????
+      {
+        MarkerCandidate &mc=OutMarkerCanditates.back();
+        reverse(mc.contour.begin(),mc.contour.end());//????
+        if (mc.cornerIdx[0]>=0)
+          for (int c=0; c<4; c++) mc.cornerIdx[c]=mc.contour.size()-1-mc.cornerIdx[c];
+      }
     }
   }
 }
 
+/*!
+ *  
+ */
+void MarkerDetector::detectRectanglesStriped(const cv::Mat &grey, double param1, double param2,
+  vector<MarkerCandidate> & OutMarkerCanditates)
+{
+  int maxDim=std::max(grey.cols,grey.rows);
+  unsigned int minSize=_minSize*maxDim*4;
+  unsigned int maxSize=_maxSize*maxDim*4;
+  //a marker must be completely seen by the stripe in which it starts. So, the stripes are enlarged
+  //downwards by the maximum height of a marker: its contour has less than maxSize points, and it
+  //goes down and up again, so that its height is below maxSize/2. In addition, some rows are added
+  //on both sides so that neither the threshold nor the erosion are affected by the limits of the
+  //stripes
+  int overlap=std::ceil(2*_maxSize*maxDim);
+  int border=int(std::max(param1,3.))/2+2;
+  int nStripes=std::min(_nStripes,grey.rows);
+
+  thres.create(grey.size(),CV_8UC1);
+  vector<vector<MarkerCandidate> > stripeQuads(nStripes);
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+  for (int s=0; s<nStripes; s++)
+  {
+    int y0=(s*grey.rows)/nStripes;
+    int y1=((s+1)*grey.rows)/nStripes;
+    int top=std::max(0,y0-border);
+    int bottom=std::min(grey.rows,y1+overlap+border);
+
+    cv::Mat stripeThres,stripeEroded;
+    thresHold(_thresMethod,grey.rowRange(top,bottom),stripeThres,param1,param2);
+    if (_doErosion)
+    {
+      erode(stripeThres,stripeEroded,cv::Mat());
+      stripeThres=stripeEroded;
+    }
+    //each stripe writes only its own rows into the thresholded image
+    cv::Mat thresRows=thres.rowRange(y0,y1);
+    stripeThres.rowRange(y0-top,y1-top).copyTo(thresRows);
+
+    vector<MarkerCandidate> quads;
+    findQuads(stripeThres,quads,minSize,maxSize,cv::Point(0,top));
+    //keep the quads starting in this stripe that are not cut by the limits of the stripe
+    for (size_t i=0; i<quads.size(); i++)
+    {
+      float minY=std::min(std::min(quads[i][0].y,quads[i][1].y),
+        std::min(quads[i][2].y,quads[i][3].y));
+      if (minY<y0 || minY>=y1) continue;
+      //findContours does not employ the first and last rows of the image, so that a contour
+      //touching the rows top+1 or bottom-2 can continue outside the stripe
+      bool isCut=false;
+      for (size_t c=0; c<quads[i].contour.size() && !isCut; c++)
+      {
+        if (top>0 && quads[i].contour[c].y<=top+1) isCut=true;
+        else if (bottom<grey.rows && quads[i].contour[c].y>=bottom-2) isCut=true;
+      }
+      if (!isCut)
+      {
+        stripeQuads[s].push_back(MarkerCandidate());
+        stripeQuads[s].back().swap(quads[i]);
+      }
+    }
+  }
+
+  //join the quads of all the stripes and remove the repeated ones
+  vector<MarkerCandidate> MarkerCanditates;
+  size_t nQuads=0;
+  for (int s=0; s<nStripes; s++) nQuads+=stripeQuads[s].size();
+  MarkerCanditates.reserve(nQuads);
+  for (int s=0; s<nStripes; s++)
+    for (size_t i=0; i<stripeQuads[s].size(); i++)
+    {
+      MarkerCanditates.push_back(MarkerCandidate());
+      MarkerCanditates.back().swap(stripeQuads[s][i]);
+    }
+  filterQuads(MarkerCanditates,OutMarkerCanditates);
+}
+
 /*!
  *  
  */
@@ -603,22 +825,19 @@ void setPointIntoImage(cv::Point  &p,cv::Size s)
 /*!
  *  
  */
-bool MarkerDetector::warp_cylinder(Mat &in, Mat &out, Size size, MarkerCandidate& mcand)
-  throw (cv::Exception)
+bool MarkerDetector::warp_cylinder(Mat &in, Mat &out, Size size, MarkerCandidate& mcand,
+  vector<int> &rowStart) throw (cv::Exception)
 {
   if (mcand.size() !=4)
     throw cv::Exception (9001, "point.size()!=4", "MarkerDetector::warp",__FILE__,__LINE__ );
 
-  //check first the real need for cylinder warping
-//     cout<<"im="<<mcand.contour.size()<<endl;
-
-//     for (size_t i=0;i<mcand.contour.size();i++) {
-//         cv::rectangle(_ssImC ,mcand.contour[i],mcand.contour[i],cv::Scalar(111,111,111),-1 );
-//     }
-//     mcand.draw(imC,cv::Scalar(0,255,0));
-  //find the 4 different segments of the contour
+  //find the 4 different segments of the contour. They are known if the candidate comes from
+  //findQuads
   vector<unsigned int> idxSegments;
-  findCornerPointsInContour(mcand,mcand.contour,idxSegments);
+  if (mcand.cornerIdx[0]>=0)
+    idxSegments.assign(mcand.cornerIdx,mcand.cornerIdx+4);
+  else
+    findCornerPointsInContour(mcand,mcand.contour,idxSegments);
   //let us rearrange the points so that the first corner is the one whith smaller idx
   int minIdx=0;
   for (int i=1; i<4; i++)
@@ -626,16 +845,14 @@ bool MarkerDetector::warp_cylinder(Mat &in, Mat &out, Size size, MarkerCandidate
   //now, rotate the points to be in this order
   std::rotate(idxSegments.begin(),idxSegments.begin()+minIdx,idxSegments.end());
   std::rotate(mcand.begin(),mcand.begin()+minIdx,mcand.end());
+  if (mcand.cornerIdx[0]>=0)
+    std::rotate(mcand.cornerIdx,mcand.cornerIdx+minIdx,mcand.cornerIdx+4);
 
-// cout<<"idxSegments="<<idxSegments[0]<< " "<<idxSegments[1]<< " "<<idxSegments[2]<<" "
-// <<idxSegments[3]<<endl;
   //now, determine the sides that are deformated by cylinder perspective
   int defrmdSide=findDeformedSidesIdx(mcand.contour,idxSegments);
-// cout<<"Def="<<defrmdSide<<endl;
 
   //instead of removing perspective distortion  of the rectangular region
   //given by the rectangle, we enlarge it a bit to include the deformed parts
-  //cv::Point2f center=mcand.getCenter();
   Point2f enlargedRegion[4];
   for (int i=0; i<4; i++) enlargedRegion[i]=mcand[i];
   if (defrmdSide==0)
@@ -655,29 +872,8 @@ bool MarkerDetector::warp_cylinder(Mat &in, Mat &out, Size size, MarkerCandidate
   for (size_t i=0; i<4; i++)
     setPointIntoImage(enlargedRegion[i],in.size());
 
-  /*
-    cv::Scalar colors[4]={cv::Scalar(0,0,255),cv::Scalar(255,0,0),cv::Scalar(0,255,0),
-      cv::Scalar(111,111,0)};
-    for (int i=0;i<4;i++)
-    {
-      cv::rectangle(_ssImC,mcand.contour[idxSegments[i]]-cv::Point(2,2),
-        mcand.contour[idxSegments[i]]+cv::Point(2,2),colors[i],-1 );
-      cv::rectangle(_ssImC,enlargedRegion[i]-cv::Point2f(2,2),enlargedRegion[i]+cv::Point2f(2,2),
-        colors[i],-1 );
-    }*/
-//     cv::imshow("imC",_ssImC);
-
-  //calculate the max distance from each contour point the line of the corresponding segment it
-  //belongs to calculate
-//      cv::waitKey(0);
-  //check that the region is into image limits
-  //obtain the perspective transform
-  Point2f  pointsRes[4],pointsIn[4];
-
-  /// \todo unroll
-  for (int i=0; i<4; i++)
-    pointsIn[i]=mcand[i];
-
+  //obtain the perspective transform from the image to the enlarged canonical region and back
+  Point2f  pointsRes[4];
   cv::Size enlargedSize=size;
   enlargedSize.width+=2*enlargedSize.width*0.2;
   pointsRes[0]= ( Point2f ( 0,0 ) );
@@ -686,69 +882,51 @@ bool MarkerDetector::warp_cylinder(Mat &in, Mat &out, Size size, MarkerCandidate
   pointsRes[3]= Point2f ( 0,enlargedSize.height-1 );
   //rotate to ensure that deformed sides are in the horizontal axis when warping
   if (defrmdSide==0) rotate(pointsRes,pointsRes+1,pointsRes+4);
-  cv::Mat imAux,imAux2(enlargedSize,CV_8UC1);
   Mat M=getPerspectiveTransform ( enlargedRegion,pointsRes );
-  cv::warpPerspective ( in, imAux,  M, enlargedSize,cv::INTER_NEAREST);
-
-  //now, transform all points to the new image
-  vector<cv::Point> pointsCO(mcand.contour.size());
-  assert(M.type()==CV_64F);
-  assert(M.cols==3 && M.rows==3);
-//     cout<<M<<endl;
-  double *mptr=M.ptr<double>(0);
-  imAux2.setTo(cv::Scalar::all(0));
+  Mat Minv=getPerspectiveTransform ( pointsRes,enlargedRegion );
+  assert(M.type()==CV_64F && Minv.type()==CV_64F);
+  const double *mptr=M.ptr<double>(0),*iptr=Minv.ptr<double>(0);
 
+  //the contour, in the enlarged region, gives the column where each row of the marker starts.
+  //Only that 1-D remap is kept. Each point marks also the rows above and below
+  rowStart.assign(enlargedSize.height,-1);
   for (size_t i=0; i<mcand.contour.size(); i++)
   {
     float inX=mcand.contour[i].x;
     float inY=mcand.contour[i].y;
     float w= inX * mptr[6]+inY * mptr[7]+mptr[8];
-    cv::Point2f pres;
-    pointsCO[i].x=( (inX * mptr[0]+inY* mptr[1]+mptr[2])/w)+0.5;
-    pointsCO[i].y=( (inX * mptr[3]+inY* mptr[4]+mptr[5])/w)+0.5;
-    //make integers
-    setPointIntoImage(pointsCO[i],imAux.size());//ensure points are into image limits
-//  cout<<"p="<<pointsCO[i]<<" "<<imAux.size().width<<" "<<imAux.size().height<<endl;
-    imAux2.at<uchar>(pointsCO[i].y,pointsCO[i].x)=255;
-    if (pointsCO[i].y>0)
-      imAux2.at<uchar>(pointsCO[i].y-1,pointsCO[i].x)=255;
-    if (pointsCO[i].y<imAux2.rows-1 )
-      imAux2.at<uchar>(pointsCO[i].y+1,pointsCO[i].x)=255;
+    cv::Point pco;
+    pco.x=( (inX * mptr[0]+inY* mptr[1]+mptr[2])/w)+0.5;
+    pco.y=( (inX * mptr[3]+inY* mptr[4]+mptr[5])/w)+0.5;
+    setPointIntoImage(pco,enlargedSize);//ensure points are into image limits
+    for (int y=std::max(0,pco.y-1); y<=std::min(enlargedSize.height-1,pco.y+1); y++)
+      if (rowStart[y]==-1 || pco.x<rowStart[y]) rowStart[y]=pco.x;
   }
-
-  cv::Mat outIm(enlargedSize,CV_8UC1);
-  outIm.setTo(cv::Scalar::all(0));
-  //now, scan in lines to determine the required displacement
-  for (int y=0; y<imAux2.rows; y++)
+  //rows without contour points take the value of the nearest previous one
+  int firstValid=0;
+  while (firstValid<enlargedSize.height && rowStart[firstValid]==-1) firstValid++;
+  if (firstValid==enlargedSize.height) return false;
+  for (int y=0; y<enlargedSize.height; y++)
+    if (rowStart[y]==-1) rowStart[y]=y<firstValid?rowStart[firstValid]:rowStart[y-1];
+
+  //sample the input image only in the pixels of the output, through the remap and the inverse
+  //perspective transform
+  out.create(size,CV_8UC1);
+  for (int y=0; y<size.height; y++)
   {
-    uchar *_offInfo=imAux2.ptr<uchar>(y);
-    int start=-1,end=-1;
-    //determine the start and end of markerd regions
-    for (int x=0; x<imAux.cols; x++)
+    uchar *outPtr=out.ptr<uchar>(y);
+    for (int x=0; x<size.width; x++)
     {
-      if (_offInfo[x])
-      {
-        if (start==-1) start=x;
-        else end=x;
-      }
+      int u=rowStart[y]+x;
+      outPtr[x]=0;
+      if (u>=enlargedSize.width) continue;
+      double w=u*iptr[6]+y*iptr[7]+iptr[8];
+      int ix=cvRound((u*iptr[0]+y*iptr[1]+iptr[2])/w);
+      int iy=cvRound((u*iptr[3]+y*iptr[4]+iptr[5])/w);
+      if (ix>=0 && iy>=0 && ix<in.cols && iy<in.rows)
+        outPtr[x]=in.at<uchar>(iy,ix);
     }
-//       cout<<"S="<<start<<" "<<end<<" "<<end-start<<" "<<(size.width>>1)<<endl;
-    //check that the size is big enough and
-    assert(start!=-1 && end!=-1 && (end-start)> size.width>>1);
-    uchar *In_image=imAux.ptr<uchar>(y);
-    uchar *Out_image=outIm.ptr<uchar>(y);
-    memcpy(Out_image,In_image+start,imAux.cols-start );
   }
-
-//     cout<<"SS="<<mcand.contour.size()<<" "<<pointsCO.size()<<endl;
-  //get the central region with the size specified
-  cv::Mat centerReg=outIm(cv::Range::all(),cv::Range(0,size.width));
-  out=centerReg.clone();
-//     cv::perspectiveTransform(mcand.contour,pointsCO,M);
-  //draw them
-//     cv::imshow("out2",out);
-//     cv::imshow("imm",imAux2);
-//     cv::waitKey(0);
   return true;
 }
 
@@ -777,60 +955,426 @@ int MarkerDetector:: perimeter ( vector<Point2f> &a )
   return sum;
 }
 
+//max size of the window employed in the Harris refinement
+const int maxHarrisBlockSize=15;
+
+namespace
+{
+
 /*!
- *  
+ * Moves the corner to the maximum of the Harris response in the window of (2*halfSize+1) pixels
+ * around it. The response is computed directly on the window with central differences and a 3x3
+ * box, using buffers in the stack. The rows are contiguous so the inner loops can be vectorized
+ * by the compiler. The maximum is refined with a parabola along each axis.
+ */
+void refineCornerHarris ( const cv::Mat &grey,cv::Point2f &corner,int halfSize )
+{
+  const int maxGSide=maxHarrisBlockSize+2;
+  const float k=0.04f;
+  int cx=cvRound ( corner.x ),cy=cvRound ( corner.y );
+  //the gradients need two extra pixels at each side of the window
+  int r=halfSize+2;
+  if ( cx-r<0 || cy-r<0 || cx+r>=grey.cols || cy+r>=grey.rows ) return;
+
+  int bSide=2*halfSize+1,gSide=bSide+2;
+  float gxx[maxGSide*maxGSide],gxy[maxGSide*maxGSide],gyy[maxGSide*maxGSide];
+  for ( int y=0; y<gSide; y++ )
+  {
+    int iy=cy-halfSize-1+y;
+    const uchar *prev=grey.ptr<uchar> ( iy-1 ) +cx-halfSize-1;
+    const uchar *cur=grey.ptr<uchar> ( iy ) +cx-halfSize-1;
+    const uchar *next=grey.ptr<uchar> ( iy+1 ) +cx-halfSize-1;
+    float *pxx=gxx+y*gSide,*pxy=gxy+y*gSide,*pyy=gyy+y*gSide;
+    for ( int x=0; x<gSide; x++ )
+    {
+      float dx=float ( cur[x+1] )-float ( cur[x-1] );
+      float dy=float ( next[x] )-float ( prev[x] );
+      pxx[x]=dx*dx;
+      pxy[x]=dx*dy;
+      pyy[x]=dy*dy;
+    }
+  }
+  //horizontal part of the 3x3 box
+  float hxx[maxGSide*maxHarrisBlockSize],hxy[maxGSide*maxHarrisBlockSize];
+  float hyy[maxGSide*maxHarrisBlockSize];
+  for ( int y=0; y<gSide; y++ )
+  {
+    const float *pxx=gxx+y*gSide,*pxy=gxy+y*gSide,*pyy=gyy+y*gSide;
+    float *oxx=hxx+y*bSide,*oxy=hxy+y*bSide,*oyy=hyy+y*bSide;
+    for ( int x=0; x<bSide; x++ )
+    {
+      oxx[x]=pxx[x]+pxx[x+1]+pxx[x+2];
+      oxy[x]=pxy[x]+pxy[x+1]+pxy[x+2];
+      oyy[x]=pyy[x]+pyy[x+1]+pyy[x+2];
+    }
+  }
+  //vertical part and response
+  float resp[maxHarrisBlockSize*maxHarrisBlockSize];
+  for ( int y=0; y<bSide; y++ )
+  {
+    const float *xx=hxx+y*bSide,*xy=hxy+y*bSide,*yy=hyy+y*bSide;
+    float *o=resp+y*bSide;
+    for ( int x=0; x<bSide; x++ )
+    {
+      float a=xx[x]+xx[x+bSide]+xx[x+2*bSide];
+      float b=xy[x]+xy[x+bSide]+xy[x+2*bSide];
+      float c=yy[x]+yy[x+bSide]+yy[x+2*bSide];
+      o[x]=a*c-b*b-k* ( a+c ) * ( a+c );
+    }
+  }
+  int best=0;
+  for ( int i=1; i<bSide*bSide; i++ )
+    if ( resp[i]>resp[best] ) best=i;
+  if ( resp[best]<=0 ) return; //no corner in the window
+
+  int bx=best%bSide,by=best/bSide;
+  float sx=0,sy=0;
+  if ( bx>0 && bx<bSide-1 )
+  {
+    float l=resp[best-1],c=resp[best],rr=resp[best+1];
+    float den=l-2*c+rr;
+    if ( den<0 ) sx=std::max ( -0.5f,std::min ( 0.5f,0.5f* ( l-rr ) /den ) );
+  }
+  if ( by>0 && by<bSide-1 )
+  {
+    float u=resp[best-bSide],c=resp[best],d=resp[best+bSide];
+    float den=u-2*c+d;
+    if ( den<0 ) sy=std::max ( -0.5f,std::min ( 0.5f,0.5f* ( u-d ) /den ) );
+  }
+  corner.x=cx+bx-halfSize+sx;
+  corner.y=cy+by-halfSize+sy;
+}
+
+}
+
+/*!
+ * Refines all the corners of the frame in one call, in parallel if USE_OMP is defined
  */
 void MarkerDetector::findBestCornerInRegion_harris (const cv::Mat & grey,
   vector<cv::Point2f> &Corners,int blockSize )
 {
-  int halfSize=blockSize/2;
-  for ( size_t i=0; i<Corners.size(); i++ )
+  int halfSize=std::min ( blockSize,maxHarrisBlockSize ) /2;
+  int nCorners=Corners.size();
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+  for ( int i=0; i<nCorners; i++ )
+    refineCornerHarris ( grey,Corners[i],halfSize );
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::refineCornersCoarseToFine ( vector<Marker> &markers )
+{
+  if ( markers.size() ==0 ) return;
+  vector<Point2f> Corners;
+  Corners.reserve ( markers.size() *4 );
+  for (size_t i=0; i<markers.size(); i++ )
+    for (int c=0; c<4; c++ )
+      Corners.push_back ( markers[i][c] );
+
+  //pyrDown centers the pixel x of the level l+1 in the pixel 2x of the level l. So, the location
+  //in the upper level is obtained by scaling and the error is about one pixel, which is corrected
+  //with a small search window
+  for (int l=pyrdown_level-1; l>=0; l-- )
+  {
+    for (size_t c=0; c<Corners.size(); c++ )
+      Corners[c]*=2.;
+    cornerSubPix ( _pyramid[l], Corners, cvSize ( 2,2 ), cvSize ( -1,-1 ),
+      cvTermCriteria ( CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,5,0.05 ) );
+  }
+
+  for (size_t i=0; i<markers.size(); i++ )
+    for (int c=0; c<4; c++ )
+      markers[i][c]=Corners[i*4+c];
+}
+
+namespace
+{
+
+/*!
+ * Computes the ratio between the shortest and longest sides of a quad and the maximum absolute
+ * cosine of its angles
+ */
+void quadRegularity ( const vector<cv::Point2f> &quad,float &sideRatio,float &maxCos )
+{
+  float minSide=0,maxSide=0;
+  maxCos=0;
+  for ( int c=0; c<4; c++ )
+  {
+    cv::Point2f v1=quad[ ( c+1 ) %4]-quad[c];
+    cv::Point2f v2=quad[ ( c+3 ) %4]-quad[c];
+    float n1=norm ( v1 ),n2=norm ( v2 );
+    if ( c==0 || n1<minSide ) minSide=n1;
+    if ( c==0 || n1>maxSide ) maxSide=n1;
+    if ( n1>0 && n2>0 )
+      maxCos=std::max ( maxCos,float ( fabs ( v1.dot ( v2 ) ) / ( n1*n2 ) ) );
+  }
+  sideRatio=maxSide>0?minSide/maxSide:0;
+}
+
+/*!
+ * Value of the nearest pixel of an 8 bit image. Points outside are moved to the border
+ */
+inline float greyAt ( const cv::Mat &grey,const cv::Point2f &p )
+{
+  int x=std::min ( std::max ( cvRound ( p.x ),0 ),grey.cols-1 );
+  int y=std::min ( std::max ( cvRound ( p.y ),0 ),grey.rows-1 );
+  return grey.at<uchar> ( y,x );
+}
+
+/*!
+ * Maps a point in the unit square to the quad by bilinear interpolation of its corners
+ */
+inline cv::Point2f quadPoint ( const vector<cv::Point2f> &q,float u,float v )
+{
+  return ( q[0]* ( 1-u ) +q[1]*u ) * ( 1-v ) + ( q[3]* ( 1-u ) +q[2]*u ) *v;
+}
+
+}
+
+/*!
+ * Cheap test done before warping. The geometry is checked first. Then, the black border is
+ * sampled at the center of its cells (7x7 grid as the markers of the library, or the one of the
+ * dictionary), and compared with the white area out of the marker and with the inner cells,
+ * among which there must be a white one.
+ */
+bool MarkerDetector::scoreCandidate ( const cv::Mat &grey,const vector<cv::Point2f> &quad )
+{
+  float sideRatio,maxCos;
+  quadRegularity ( quad,sideRatio,maxCos );
+  if ( sideRatio<_scoreMinSideRatio || maxCos>_scoreMaxCos )
+    return false;
+
+  const int nCells=_useDictionary?_dictionary.getGridSize()+2*_dictionary.getBorderWidth():7;
+  const float cell=1.f/nCells;
+  //sides: the border cells along each side, the outside samples are displaced one cell out
+  float minEdgeContrast=255,borderSum=0;
+  int nBorder=0;
+  for ( int side=0; side<4; side++ )
   {
-    //check that the region is into the image limits
-    cv::Point2f min ( Corners[i].x-halfSize,Corners[i].y-halfSize );
-    cv::Point2f max ( Corners[i].x+halfSize,Corners[i].y+halfSize );
-    if ( min.x>=0  &&  min.y>=0 && max.x<grey.cols && max.y<grey.rows )
+    float inSum=0,outSum=0;
+    for ( int k=1; k<nCells-1; k++ )
     {
-      cv::Mat response;
-      cv::Mat subImage ( grey,cv::Rect ( Corners[i].x-halfSize,Corners[i].y-halfSize,blockSize,
-         blockSize));
-      vector<Point2f> corners2;
-      goodFeaturesToTrack ( subImage, corners2, 10, 0.001, halfSize );
-      float minD=9999;
-      int bIdx=-1;
-      cv::Point2f Center ( halfSize,halfSize );
-      for ( size_t j=0; j<corners2.size(); j++ )
+      float t= ( k+0.5f ) *cell,in=0.5f*cell,out=-0.5f*cell;
+      float uin,vin,uout,vout;
+      switch ( side )
       {
-        float dist=cv::norm ( corners2[j]-Center );
-        if ( dist<minD )
-        {
-          minD=dist;
-          bIdx=j;
-        }
-        if ( minD<halfSize ) Corners[i]+= ( corners2[bIdx]-Center );
+      case 0: uin=uout=t; vin=in; vout=out; break;
+      case 1: vin=vout=t; uin=1-in; uout=1-out; break;
+      case 2: uin=uout=t; vin=1-in; vout=1-out; break;
+      default: vin=vout=t; uin=in; uout=out; break;
       }
+      inSum+=greyAt ( grey,quadPoint ( quad,uin,vin ) );
+      outSum+=greyAt ( grey,quadPoint ( quad,uout,vout ) );
     }
+    borderSum+=inSum;
+    nBorder+=nCells-2;
+    minEdgeContrast=std::min ( minEdgeContrast, ( outSum-inSum ) /float ( nCells-2 ) );
   }
+  if ( minEdgeContrast<_scoreMinEdgeContrast )
+    return false;
+
+  //the brightest inner cell must be brighter than the border
+  float maxInterior=0;
+  for ( int y=1; y<nCells-1; y++ )
+    for ( int x=1; x<nCells-1; x++ )
+      maxInterior=std::max ( maxInterior,
+        greyAt ( grey,quadPoint ( quad, ( x+0.5f ) *cell, ( y+0.5f ) *cell ) ) );
+  return maxInterior-borderSum/float ( nBorder ) >=_scoreMinInteriorContrast;
 }
 
 /*!
  *  
  */
-void MarkerDetector::refineCandidateLines(MarkerDetector::MarkerCandidate& candidate)
+void MarkerDetector::sortCandidatesByPriority ( vector<MarkerCandidate> &candidates,float scale )
+{
+  //the candidates are sorted by descending score
+  vector<pair<float,int> > scores ( candidates.size() );
+  for ( size_t i=0; i<candidates.size(); i++ )
+  {
+    float score=candidates[i].getArea();
+    if ( _priority==PRIORITY_PREVIOUS && _prevCenters.size() >0 )
+    {
+      cv::Point2f center=candidates[i].getCenter() *scale;
+      float minDist=norm ( center-_prevCenters[0] );
+      for ( size_t p=1; p<_prevCenters.size(); p++ )
+        minDist=std::min ( minDist,float ( norm ( center-_prevCenters[p] ) ) );
+      score=-minDist;
+    }
+    else if ( _priority==PRIORITY_REGULARITY )
+    {
+      //ratio between the shortest and longest sides weighted by the worst angle
+      float sideRatio,maxCos;
+      quadRegularity ( candidates[i],sideRatio,maxCos );
+      score=sideRatio* ( 1-maxCos );
+    }
+    scores[i]=make_pair ( -score,int ( i ) );
+  }
+  std::sort ( scores.begin(),scores.end() );
+
+  //reorder without copying the contours
+  vector<MarkerCandidate> sorted ( candidates.size() );
+  for ( size_t i=0; i<scores.size(); i++ )
+  {
+    MarkerCandidate &src=candidates[scores[i].second];
+    sorted[i].swap ( src );
+  }
+  candidates.swap ( sorted );
+}
+
+/*!
+ * Controller of the auto tuning. The smallest and largest marker sides of the last frames are
+ * employed to select the coarsest pyramid level in which the smallest one has still
+ * _tuneMinSide pixels, and the min/max sizes, that are relaxed by a factor 2 so that markers are
+ * not lost when they move towards or away from the camera.
+ */
+void MarkerDetector::updateAutoTuning ( const vector<Marker> &markers,cv::Size imSize )
 {
-  // search corners on the contour vector
-  vector<unsigned int> cornerIndex;
-  cornerIndex.resize(4);
-  for (unsigned int j=0; j<candidate.contour.size(); j++)
+  const size_t historySize=10;
+  if ( markers.size() ==0 )
   {
-    for (unsigned int k=0; k<4; k++)
+    //markers lost. Use the values of the user until they are found again
+    if ( ++_tuneFramesLost>=_tuneFramesToReset )
     {
-      if (candidate.contour[j].x==candidate[k].x && candidate.contour[j].y==candidate[k].y)
+      _tuneMinSides.clear();
+      _tuneMaxSides.clear();
+      pyrdown_level=_userPyrLevel;
+      _minSize=_userMinSize;
+      _maxSize=_userMaxSize;
+    }
+    return;
+  }
+  _tuneFramesLost=0;
+
+  //sides of the smallest and largest markers in this frame
+  float minSide=cv::norm ( markers[0][0]-markers[0][1] ),maxSide=minSide;
+  for ( size_t i=0; i<markers.size(); i++ )
+  {
+    for ( int c=0; c<4; c++ )
+    {
+      float side=cv::norm ( markers[i][c]-markers[i][ ( c+1 ) %4] );
+      minSide=std::min ( minSide,side );
+      maxSide=std::max ( maxSide,side );
+    }
+  }
+  if ( _tuneMinSides.size() ==historySize )
+  {
+    _tuneMinSides.erase ( _tuneMinSides.begin() );
+    _tuneMaxSides.erase ( _tuneMaxSides.begin() );
+  }
+  _tuneMinSides.push_back ( minSide );
+  _tuneMaxSides.push_back ( maxSide );
+  minSide=*std::min_element ( _tuneMinSides.begin(),_tuneMinSides.end() );
+  maxSide=*std::max_element ( _tuneMaxSides.begin(),_tuneMaxSides.end() );
+
+  //coarsest level in which the smallest marker still has enough pixels
+  int level=0;
+  while ( level<4 && minSide/float ( 2<< level ) >=_tuneMinSide )
+    level++;
+  pyrdown_level=level;
+
+  //tighten the sizes. Sizes are relative to the largest image dimension and refer to the sides
+  float maxDim=std::max ( imSize.width,imSize.height );
+  _minSize=std::max ( _userMinSize,0.5f*minSide/maxDim );
+  _maxSize=std::min ( _userMaxSize,2.f*maxSide/maxDim );
+  if ( _maxSize<=_minSize )
+  {
+    _minSize=_userMinSize;
+    _maxSize=_userMaxSize;
+  }
+}
+
+/*!
+ * Finds the position of the corners of the quad in its contour. The corners are points of the
+ * contour returned by approxPolyDP, so a single pass is enough
+ */
+void MarkerDetector::locateCornersInContour(MarkerCandidate &candidate,
+  const vector<cv::Point> &corners)
+{
+  int found=0;
+  for (int k=0; k<4; k++) candidate.cornerIdx[k]=-1;
+  for (size_t j=0; j<candidate.contour.size() && found<4; j++)
+    for (int k=0; k<4; k++)
+      if (candidate.cornerIdx[k]<0 && candidate.contour[j]==corners[k])
       {
-        cornerIndex[k] = j;
+        candidate.cornerIdx[k]=j;
+        found++;
+        break;
       }
-    }
+  if (found<4) candidate.cornerIdx[0]=-1;
+}
+
+namespace
+{
+
+/*!
+ * Fits the line a*x+b*y+c=0 (with a^2+b^2=1) to the contour points from index 'from' to index 'to'
+ * by weighted total least squares. The points near the corners, where the contour bends, have
+ * lower weight. Returns false if there are not enough points
+ */
+bool fitContourLine(const vector<cv::Point> &contour,int from,int to,int inc,cv::Point3f &line)
+{
+  int n=int(contour.size());
+  int nPoints=(inc>0?to-from:from-to);
+  if (nPoints<0) nPoints+=n;
+  nPoints++;
+  if (nPoints<2) return false;
+  //the weight grows linearly up to 1 in the first and last eighth of the side
+  double margin=nPoints/8.+1.;
+  double sw=0,sx=0,sy=0,sxx=0,sxy=0,syy=0;
+  for (int k=0,j=from; k<nPoints; k++,j+=inc)
+  {
+    if (j==n) j=0;
+    else if (j<0) j=n-1;
+    double w=std::min(1.,(std::min(k,nPoints-1-k)+1)/margin);
+    double x=contour[j].x,y=contour[j].y;
+    sw+=w;
+    sx+=w*x;
+    sy+=w*y;
+    sxx+=w*x*x;
+    sxy+=w*x*y;
+    syy+=w*y*y;
   }
+  double mx=sx/sw,my=sy/sw;
+  double cxx=sxx/sw-mx*mx,cxy=sxy/sw-mx*my,cyy=syy/sw-my*my;
+  //direction of the line: main axis of the covariance. The normal is perpendicular
+  double theta=0.5*atan2(2*cxy,cxx-cyy);
+  double a=-sin(theta),b=cos(theta);
+  line=cv::Point3f(a,b,-(a*mx+b*my));
+  return true;
+}
+
+/*!
+ * Intersection of two lines by Cramer's rule. Returns false if they are parallel
+ */
+bool crossLines(const cv::Point3f &l1,const cv::Point3f &l2,cv::Point2f &p)
+{
+  double det=double(l1.x)*l2.y-double(l2.x)*l1.y;
+  if (fabs(det)<1e-9) return false;
+  p.x=(double(l1.y)*l2.z-double(l2.y)*l1.z)/det;
+  p.y=(double(l2.x)*l1.z-double(l1.x)*l2.z)/det;
+  return true;
+}
+
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::refineCandidateLines(MarkerDetector::MarkerCandidate& candidate)
+{
+  if (candidate.cornerIdx[0]<0)
+  {
+    //corners not located yet. It is done here, and not in findQuads, so that it is only done for
+    //the identified markers
+    vector<cv::Point> corners(4);
+    for (int k=0; k<4; k++) corners[k]=cv::Point(candidate[k].x,candidate[k].y);
+    locateCornersInContour(candidate,corners);
+    if (candidate.cornerIdx[0]<0) return;
+  }
+  const int *cornerIndex=candidate.cornerIdx;
 
   // contour pixel in inverse order or not?
   bool inverse;
@@ -841,120 +1385,146 @@ void MarkerDetector::refineCandidateLines(MarkerDetector::MarkerCandidate& candi
     inverse = false;
   else inverse = true;
 
-
-  // get pixel vector for each line of the marker
-  int inc = 1;
-  if (inverse) inc = -1;
-
-  vector<std::vector<cv::Point> > contourLines;
-  contourLines.resize(4);
-  for (unsigned int l=0; l<4; l++)
-  {
-    for (int j=(int)cornerIndex[l]; j!=(int)cornerIndex[(l+1)%4]; j+=inc)
-    {
-      if (j==(int)candidate.contour.size() && !inverse) j=0;
-      else if (j==0 && inverse) j=candidate.contour.size()-1;
-      contourLines[l].push_back(candidate.contour[j]);
-      if (j==(int)cornerIndex[(l+1)%4]) break; // this has to be added because of the previous ifs
-    }
-
-  }
-
-  // interpolate marker lines
-  vector<Point3f> lines;
-  lines.resize(4);
-  for (unsigned int j=0; j<lines.size(); j++) interpolate2Dline(contourLines[j], lines[j]);
+  // interpolate marker lines, directly from the contour points of each side
+  cv::Point3f lines[4];
+  for (int l=0; l<4; l++)
+    if (!fitContourLine(candidate.contour,cornerIndex[l],cornerIndex[(l+1)%4],inverse?-1:1,
+        lines[l]))
+      return;
 
   // get cross points of lines
-  vector<Point2f> crossPoints;
-  crossPoints.resize(4);
-  for (unsigned int i=0; i<4; i++)
-    crossPoints[i] = getCrossPoint( lines[(i-1)%4], lines[i] );
+  cv::Point2f crossPoints[4];
+  for (int i=0; i<4; i++)
+    if (!crossLines(lines[(i+3)%4],lines[i],crossPoints[i])) return;
 
   // reassing points
   for (unsigned int j=0; j<4; j++)
     candidate[j] = crossPoints[j];
 }
 
+namespace
+{
+
 /*!
- *  
+ * Bilinear interpolation of an 8 bit image. Returns false if the point is out of the image
  */
-void MarkerDetector::interpolate2Dline( const std::vector< Point >& inPoints, Point3f& outLine)
+inline bool greyBilinear(const cv::Mat &grey,float x,float y,float &val)
 {
+  int x0=cvFloor(x),y0=cvFloor(y);
+  if (x0<0 || y0<0 || x0+1>=grey.cols || y0+1>=grey.rows) return false;
+  float fx=x-x0,fy=y-y0;
+  const uchar *r0=grey.ptr<uchar>(y0)+x0,*r1=grey.ptr<uchar>(y0+1)+x0;
+  val=(r0[0]*(1-fx)+r0[1]*fx)*(1-fy)+(r1[0]*(1-fx)+r1[1]*fx)*fy;
+  return true;
+}
 
-  float minX, maxX, minY, maxY;
-  minX = maxX = inPoints[0].x;
-  minY = maxY = inPoints[0].y;
-  for (unsigned int i=1; i<inPoints.size(); i++)
-  {
-    if (inPoints[i].x < minX) minX = inPoints[i].x;
-    if (inPoints[i].x > maxX) maxX = inPoints[i].x;
-    if (inPoints[i].y < minY) minY = inPoints[i].y;
-    if (inPoints[i].y > maxY) maxY = inPoints[i].y;
-  }
-
-  // create matrices of equation system
-  Mat A(inPoints.size(),2,CV_32FC1, Scalar(0));
-  Mat B(inPoints.size(),1,CV_32FC1, Scalar(0));
-  Mat X;
-
-  if ( maxX-minX > maxY-minY )
+/*!
+ * Refines the four sides of a marker. For each side, intensity profiles are taken along its
+ * normal at a set of points. The derivative of each profile is computed and its maximum (dark
+ * inside, bright outside) is located with subpixel precision by fitting a parabola. The edge
+ * points found are employed to fit a line by total least squares, weighted by the strength of the
+ * edge, and the corners are the intersections of consecutive lines. Two passes are done, the
+ * second with a shorter profile. All the buffers are in the stack.
+ */
+void refineMarkerEdges(const cv::Mat &grey,vector<cv::Point2f> &corners)
+{
+  const int maxSamples=32;
+  const int maxRadius=3;
+  cv::Point2f center=(corners[0]+corners[1]+corners[2]+corners[3])*0.25f;
+  for (int pass=0; pass<2; pass++)
   {
-    // Ax + C = y
-    for (unsigned int i=0; i<inPoints.size(); i++)
+    int radius=pass==0?maxRadius:2;
+    cv::Point3f lines[4];
+    for (int l=0; l<4; l++)
     {
-      A.at<float>(i, 0) = inPoints[i].x;
-      A.at<float>(i, 1) = 1.;
-      B.at<float>(i, 0) = inPoints[i].y;
+      cv::Point2f p0=corners[l],p1=corners[(l+1)%4];
+      cv::Point2f dir=p1-p0;
+      float len=norm(dir);
+      if (len<4) return;
+      dir*=1.f/len;
+      //normal pointing outside the marker
+      cv::Point2f nrm(-dir.y,dir.x);
+      if (nrm.dot(p0-center)<0) nrm=-nrm;
+      //samples in the central part of the side, away from the corners
+      int nSamples=std::max(2,std::min(maxSamples,int(len/2)));
+      double sw=0,sx=0,sy=0,sxx=0,sxy=0,syy=0;
+      for (int k=0; k<nSamples; k++)
+      {
+        float t=0.15f+0.7f*(k+0.5f)/nSamples;
+        cv::Point2f q=p0+(p1-p0)*t;
+        float prof[2*maxRadius+3];
+        bool valid=true;
+        for (int j=-radius-1; j<=radius+1 && valid; j++)
+          valid=greyBilinear(grey,q.x+nrm.x*j,q.y+nrm.y*j,prof[j+radius+1]);
+        if (!valid) continue;
+        //derivative along the normal and its maximum
+        float deriv[2*maxRadius+1];
+        int best=0;
+        for (int j=0; j<2*radius+1; j++)
+        {
+          deriv[j]=prof[j+2]-prof[j];
+          if (deriv[j]>deriv[best]) best=j;
+        }
+        if (deriv[best]<=0) continue;
+        float offset=0;
+        if (best>0 && best<2*radius)
+        {
+          float den=deriv[best-1]-2*deriv[best]+deriv[best+1];
+          if (den<0) offset=0.5f*(deriv[best-1]-deriv[best+1])/den;
+        }
+        cv::Point2f e=q+nrm*(best-radius+offset);
+        double w=deriv[best];
+        sw+=w;
+        sx+=w*e.x;
+        sy+=w*e.y;
+        sxx+=w*e.x*e.x;
+        sxy+=w*e.x*e.y;
+        syy+=w*e.y*e.y;
+      }
+      if (sw<=0) return;
+      double mx=sx/sw,my=sy/sw;
+      double theta=0.5*atan2(2*(sxy/sw-mx*my),(sxx/sw-mx*mx)-(syy/sw-my*my));
+      double a=-sin(theta),b=cos(theta);
+      lines[l]=cv::Point3f(a,b,-(a*mx+b*my));
     }
-
-    // solve system
-    solve(A,B,X, DECOMP_SVD);
-    // return Ax + By + C
-    outLine = Point3f(X.at<float>(0,0), -1., X.at<float>(1,0));
-  }
-  else
-  {
-    // By + C = x
-    for (unsigned int i=0; i<inPoints.size(); i++)
+    cv::Point2f refined[4];
+    for (int i=0; i<4; i++)
     {
-
-      A.at<float>(i, 0) = inPoints[i].y;
-      A.at<float>(i, 1) = 1.;
-      B.at<float>(i, 0) = inPoints[i].x;
-
+      if (!crossLines(lines[(i+3)%4],lines[i],refined[i])) return;
+      //do not accept large displacements
+      if (norm(refined[i]-corners[i])>2*maxRadius) return;
     }
-
-    // solve system
-    solve(A,B,X, DECOMP_SVD);
-    // return Ax + By + C
-    outLine = Point3f(-1., X.at<float>(0,0), X.at<float>(1,0));
+    for (int i=0; i<4; i++) corners[i]=refined[i];
   }
 }
 
+}
+
 /*!
  *  
  */
-Point2f MarkerDetector::getCrossPoint(const cv::Point3f& line1, const cv::Point3f& line2)
+void MarkerDetector::refineCornersEdges(const cv::Mat &grey,vector<Marker> &markers)
 {
+  int n=markers.size();
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+  for (int i=0; i<n; i++)
+    refineMarkerEdges(grey,markers[i]);
+}
 
-  // create matrices of equation system
-  Mat A(2,2,CV_32FC1, Scalar(0));
-  Mat B(2,1,CV_32FC1, Scalar(0));
-  Mat X;
-
-  A.at<float>(0, 0) = line1.x;
-  A.at<float>(0, 1) = line1.y;
-  B.at<float>(0, 0) = -line1.z;
-
-  A.at<float>(1, 0) = line2.x;
-  A.at<float>(1, 1) = line2.y;
-  B.at<float>(1, 0) = -line2.z;
-
-  // solve system
-  solve(A,B,X, DECOMP_SVD);
-  return Point2f(X.at<float>(0,0), X.at<float>(1,0));
-
+/*!
+ *  
+ */
+void MarkerDetector::refineCandidatesLines(vector<MarkerCandidate> &candidates,
+  const vector<int> &which)
+{
+  int n=which.size();
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+  for (int i=0; i<n; i++)
+    refineCandidateLines(candidates[which[i]]);
 }
 
 /*!
@@ -1054,8 +1624,62 @@ void MarkerDetector::setMinMaxSize(float min ,float max )throw(cv::Exception)
   if (min>max)
     throw cv::Exception(1," min>max","MarkerDetector::setMinMaxSize",__FILE__,__LINE__);
 
-  _minSize=min;
-  _maxSize=max;
+  _minSize=_userMinSize=min;
+  _maxSize=_userMaxSize=max;
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::setNumberOfStripes(int nStripes)throw(cv::Exception)
+{
+  if (nStripes<1)
+    throw cv::Exception(1," nStripes must be >=1","MarkerDetector::setNumberOfStripes",
+      __FILE__,__LINE__);
+  _nStripes=nStripes;
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::enableAutoTuning(bool enable,int minMarkerSide,int nFramesToReset)
+  throw(cv::Exception)
+{
+  if (minMarkerSide<1)
+    throw cv::Exception(1," minMarkerSide must be >=1","MarkerDetector::enableAutoTuning",
+      __FILE__,__LINE__);
+  if (nFramesToReset<1)
+    throw cv::Exception(1," nFramesToReset must be >=1","MarkerDetector::enableAutoTuning",
+      __FILE__,__LINE__);
+  _autoTuning=enable;
+  _tuneMinSide=minMarkerSide;
+  _tuneFramesToReset=nFramesToReset;
+  //start from the values of the user in any case
+  _tuneFramesLost=0;
+  _tuneMinSides.clear();
+  _tuneMaxSides.clear();
+  pyrdown_level=_userPyrLevel;
+  _minSize=_userMinSize;
+  _maxSize=_userMaxSize;
+}
+
+/*!
+ *  
+ */
+void MarkerDetector::setCandidateScoring(bool enable,float minEdgeContrast,
+  float minInteriorContrast,float minSideRatio,float maxCosAngle)throw(cv::Exception)
+{
+  if (minSideRatio<0 || minSideRatio>1)
+    throw cv::Exception(1," minSideRatio out of range","MarkerDetector::setCandidateScoring",
+      __FILE__,__LINE__);
+  if (maxCosAngle<0 || maxCosAngle>1)
+    throw cv::Exception(1," maxCosAngle out of range","MarkerDetector::setCandidateScoring",
+      __FILE__,__LINE__);
+  _candidateScoring=enable;
+  _scoreMinEdgeContrast=minEdgeContrast;
+  _scoreMinInteriorContrast=minInteriorContrast;
+  _scoreMinSideRatio=minSideRatio;
+  _scoreMaxCos=maxCosAngle;
 }
 
 }
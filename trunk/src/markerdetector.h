@@ -33,6 +33,8 @@ or implied, of Rafael Muñoz Salinas.
 #include "cameraparameters.h"
 #include "exports.h"
 #include "marker.h"
+#include "markerarrays.h"
+#include "dictionary.h"
 using namespace std;
 
 namespace aruco
@@ -47,23 +49,52 @@ class ARUCO_EXPORTS  MarkerDetector
   class MarkerCandidate: public Marker
   {
     public:
-      MarkerCandidate() {}
-      MarkerCandidate(const Marker &M): Marker(M) {}
+      MarkerCandidate():idx(-1)
+      {
+        for (int i=0; i<4; i++) cornerIdx[i]=-1;
+      }
+      MarkerCandidate(const Marker &M): Marker(M),idx(-1)
+      {
+        for (int i=0; i<4; i++) cornerIdx[i]=-1;
+      }
       MarkerCandidate(const  MarkerCandidate &M): Marker(M)
       {
         contour=M.contour;
         idx=M.idx;
+        for (int i=0; i<4; i++) cornerIdx[i]=M.cornerIdx[i];
       }
       MarkerCandidate & operator=(const  MarkerCandidate &M)
       {
         (*(Marker*)this)=(*(Marker*)&M);
         contour=M.contour;
         idx=M.idx;
+        for (int i=0; i<4; i++) cornerIdx[i]=M.cornerIdx[i];
         return *this;
       }
+#ifdef ARUCO_HAS_MOVE
+      MarkerCandidate(MarkerCandidate &&M):idx(-1)
+      {
+        for (int i=0; i<4; i++) cornerIdx[i]=-1;
+        swap(M);
+      }
+      MarkerCandidate & operator=(MarkerCandidate &&M)
+      {
+        swap(M);
+        return *this;
+      }
+#endif
+      //exchanges the content with the candidate passed, without copying the points
+      void swap(MarkerCandidate &M)
+      {
+        Marker::swap(M);
+        contour.swap(M.contour);
+        std::swap(idx,M.idx);
+        for (int i=0; i<4; i++) std::swap(cornerIdx[i],M.cornerIdx[i]);
+      }
 
       vector<cv::Point> contour;//all the points of its contour
       int idx;//index position in the global contour list
+      int cornerIdx[4];//position of the corners in contour (-1 in the first if unknown)
   };
 
   public:
@@ -110,6 +141,20 @@ class ARUCO_EXPORTS  MarkerDetector
       CameraParameters camParams, float markerSizeMeters=-1, bool setYPerperdicular=true)
       throw (cv::Exception);
 
+    /** @brief Detects the markers in the image passed, storing them as parallel arrays.
+     *
+     * As the detect functions above, but the output is a MarkerArrays object, that can be reused
+     * across frames without allocating memory.
+     */
+    void detect(const cv::Mat &input,MarkerArrays &detectedMarkers,cv::Mat camMatrix=cv::Mat(),
+      cv::Mat distCoeff=cv::Mat(),float markerSizeMeters=-1,bool setYPerperdicular=true)
+      throw (cv::Exception);
+
+    /** @brief Detects the markers in the image passed, storing them as parallel arrays.
+     */
+    void detect(const cv::Mat &input,MarkerArrays &detectedMarkers,CameraParameters camParams,
+      float markerSizeMeters=-1,bool setYPerperdicular=true) throw (cv::Exception);
+
     /**This set the type of thresholding methods available
      */
     enum ThresholdMethods {FIXED_THRES,ADPT_THRES,CANNY};
@@ -162,9 +207,11 @@ class ARUCO_EXPORTS  MarkerDetector
       return thres;
     }
 
-    /**Methods for corner refinement
+    /**Methods for corner refinement.
+     * EDGES locates the border of the marker with subpixel precision along the normal of each
+     * side, fits a line to each side and intersects them.
      */
-    enum CornerRefinementMethod {NONE,HARRIS,SUBPIX,LINES};
+    enum CornerRefinementMethod {NONE,HARRIS,SUBPIX,LINES,EDGES};
 
     /**
      */
@@ -240,11 +287,31 @@ class ARUCO_EXPORTS  MarkerDetector
      * deg  to be in its ideal position. (The way you would see it when you print it). This is
      * employed to know always which is the corner that acts as reference system. Second, the
      * function must return -1 if the image does not contains one of your markers, and its id
-     * otherwise.
+     * otherwise. If the library is compiled with USE_OMP, the function is called from several
+     * threads at the same time, so it must be thread safe.
      */
     void setMakerDetectorFunction(int (* markerdetector_func)(const cv::Mat &in,int &nRotations) )
     {
       markerIdDetector_ptrfunc=markerdetector_func;
+      _useDictionary=false;
+    }
+
+    /**Sets the dictionary of markers to detect (see Dictionary). It replaces the function set with
+     * setMakerDetectorFunction. By default, the markers of the library are detected. To correct
+     * errors in them, use a copy of Dictionary::getArucoDictionary() with
+     * Dictionary::setMaxCorrectionBits
+     */
+    void setDictionary(const Dictionary &dictionary)
+    {
+      _dictionary=dictionary;
+      _useDictionary=true;
+    }
+
+    /**Returns the dictionary employed. Only meaningful if setDictionary has been called
+     */
+    const Dictionary & getDictionary()const
+    {
+      return _dictionary;
     }
 
     /** Use an smaller version of the input image for marker detection.
@@ -257,7 +324,145 @@ class ARUCO_EXPORTS  MarkerDetector
      */
     void pyrDown(unsigned int level)
     {
-      pyrdown_level=level;
+      pyrdown_level=_userPyrLevel=level;
+    }
+
+    /** Enables the automatic tuning of the pyrDown level and of the min and max sizes (see
+     * setMinMaxSize) from the sizes of the markers detected in the last frames. The coarsest level
+     * in which the smallest marker seen still has a side of minMarkerSide pixels is employed, and
+     * the size limits are tightened around the markers seen, with a margin so that they can get
+     * closer or farther. If no marker is detected during nFramesToReset consecutive frames, the
+     * values set by the user are restored until markers are detected again.
+     *
+     * While enabled, getMinMaxSize returns the values currently employed. Disabling it restores the
+     * values set by the user.
+     * @param enable enables/disables the tuning
+     * @param minMarkerSide minimum side (in pixels) of the markers in the reduced image
+     * @param nFramesToReset number of frames without detections to restore the user values
+     */
+    void enableAutoTuning(bool enable,int minMarkerSide=20,int nFramesToReset=5)
+      throw(cv::Exception);
+
+    /**
+     */
+    bool isAutoTuningEnabled()const
+    {
+      return _autoTuning;
+    }
+
+    /** Enables the coarse-to-fine mode, that only has effect if pyrDown(level) is used with
+     * level>0. Markers are detected and identified in the reduced image. Then, their corners are
+     * refined in a small window at each level of the (cached) image pyramid up to the original
+     * image. So, you obtain the speed of the reduced image with the precision of the original one.
+     *
+     * In this mode, the refinement set with setCornerRefinementMethod is not applied, except for
+     * LINES, that is done in the reduced image before going up in the pyramid.
+     */
+    void enableCoarseToFine(bool enable)
+    {
+      _coarseToFine=enable;
+    }
+
+    /**
+     */
+    bool isCoarseToFineEnabled()const
+    {
+      return _coarseToFine;
+    }
+
+    /** Enables the warping for markers on cylindrical surfaces (pipes, bottles...). The rows of
+     * the canonical image are displaced so that they start at the contour of the marker.
+     */
+    void enableCylinderWarp(bool enable)
+    {
+      _enableCylinderWarp=enable;
+    }
+
+    /**
+     */
+    bool isCylinderWarpEnabled()const
+    {
+      return _enableCylinderWarp;
+    }
+
+    /** Enables the striped mode. The image is split in horizontal stripes that are thresholded and
+     * analyzed independently (in parallel if the library is compiled with USE_OMP). Each stripe is
+     * enlarged downwards by twice the maximum marker size (see setMinMaxSize), the height of the
+     * largest marker rotated 45 deg, so that the markers crossing a seam are completely seen by the
+     * stripe in which they start. Thus, the smaller the max size, the smaller the overlap between
+     * stripes.
+     *
+     * @param nStripes number of stripes. A value of 1 (default) disables the striped mode
+     */
+    void setNumberOfStripes(int nStripes)throw(cv::Exception);
+
+    /**
+     */
+    int getNumberOfStripes()const
+    {
+      return _nStripes;
+    }
+
+    /**Order in which the candidates are analyzed when a time budget is set
+     * - PRIORITY_AREA: larger candidates first
+     * - PRIORITY_PREVIOUS: candidates closer to the markers detected in the previous call first
+     * (larger first if there were no markers)
+     * - PRIORITY_REGULARITY: candidates closer to a square first
+     */
+    enum CandidatePriority {PRIORITY_AREA,PRIORITY_PREVIOUS,PRIORITY_REGULARITY};
+
+    /** Sets a time budget for each call to detect. Candidates are identified in the order
+     * indicated by priority, and when the time is over, the rest of candidates are discarded.
+     * Then, the markers found so far are returned and isLastDetectionPartial() returns true.
+     * Please notice that thresholding and contour extraction are always done, so the budget can
+     * be slightly exceeded.
+     * @param milliseconds time allowed for each call. A value <=0 (default) disables the budget
+     * @param priority order in which the candidates are analyzed
+     */
+    void setTimeBudget(double milliseconds,CandidatePriority priority=PRIORITY_AREA)
+    {
+      _timeBudget=milliseconds;
+      _priority=priority;
+    }
+
+    /**
+     */
+    double getTimeBudget()const
+    {
+      return _timeBudget;
+    }
+
+    /**Indicates whether the time budget expired in the last call to detect, so that some
+     * candidates were not analyzed
+     */
+    bool isLastDetectionPartial()const
+    {
+      return _partial;
+    }
+
+    /** Enables a cheap test of the candidates that is done before warping them, so that the
+     * regions that can not be markers (windows, tiles, screens...) are discarded with a few pixel
+     * reads. The candidates must pass all these tests:
+     * - the mean difference between the white area around each side and the black border must be
+     * at least minEdgeContrast
+     * - the brightest cell inside the border must be brighter than the border by
+     * minInteriorContrast
+     * - the ratio between the shortest and the longest sides must be at least minSideRatio
+     * - the absolute cosine of all angles must be at most maxCosAngle
+     *
+     * The border is sampled assuming the 7x7 grid of the markers of this library, or the grid of
+     * the dictionary set with setDictionary. If you employ your own markers (see
+     * setMakerDetectorFunction), adapt the thresholds or disable it.
+     * Rejected candidates are returned by getCandidates().
+     */
+    void setCandidateScoring(bool enable,float minEdgeContrast=15,float minInteriorContrast=15,
+      float minSideRatio=0.2,float maxCosAngle=0.8)throw(cv::Exception);
+
+    /**
+     */
+    bool isCandidateScoringEnabled()const
+    {
+      return _candidateScoring;
     }
 
     ///-------------------------------------------------
@@ -324,8 +529,9 @@ class ARUCO_EXPORTS  MarkerDetector
   private:
 
     bool _enableCylinderWarp;
-    bool warp_cylinder ( cv::Mat &in,cv::Mat &out,cv::Size size, MarkerCandidate& mc )
-      throw ( cv::Exception );
+    //rowStart is a buffer that can be reused between calls
+    bool warp_cylinder ( cv::Mat &in,cv::Mat &out,cv::Size size, MarkerCandidate& mc,
+      vector<int> &rowStart ) throw ( cv::Exception );
 
     /**
     * Detection of candidates to be markers, i.e., rectangles.
@@ -333,7 +539,29 @@ class ARUCO_EXPORTS  MarkerDetector
     */
     void detectRectangles(const cv::Mat &thresImg,vector<MarkerCandidate> & candidates);
 
-    ThresholdMethods _thresMethod;                 //Current threshold method
+    /**
+    * Finds the convex quads in a thresholded image. The image passed is modified by
+    * findContours. Size limits are expressed as the number of points of the contours and the
+    * coordinates of the candidates are displaced by offset
+    */
+    void findQuads(cv::Mat &thresImg,vector<MarkerCandidate> & candidates,
+      unsigned int minSize,unsigned int maxSize,cv::Point offset=cv::Point(0,0));
+
+    /**
+    * Sorts the corners of the quads in anti-clockwise order and removes the quads that are too
+    * close to each other
+    */
+    //the quads passed are moved to candidates (the removed ones are left in quads)
+    void filterQuads(vector<MarkerCandidate> & quads,vector<MarkerCandidate> & candidates);
+
+    /**
+    * Thresholds and finds candidates in horizontal stripes of the image. Stripes are processed in
+    * parallel if USE_OMP is defined
+    */
+    void detectRectanglesStriped(const cv::Mat &grey,double param1,double param2,
+      vector<MarkerCandidate> & candidates);
+
+    ThresholdMethods _thresMethod;                //Current threshold method
     double _thresParam1,_thresParam2;              //Threshold parameters
     CornerRefinementMethod _cornerMethod;          //Current corner method
     float _minSize,_maxSize;                       //minimum and maximum size of a contour lenght
@@ -343,9 +571,28 @@ class ARUCO_EXPORTS  MarkerDetector
     vector<std::vector<cv::Point2f> > _candidates; // candidates to be markers. This is a vector
                                                   //with a set of rectangles that have no valid id
     int pyrdown_level;                             //level of image reduction
+    bool _coarseToFine;                            //detect in reduced image, refine up to level 0
+    vector<cv::Mat> _pyramid;                      //pyramid of grey. Kept to reuse the memory
+    int _nStripes;                                 //number of stripes (1 = no stripes)
+    int _userPyrLevel;                             //values set by the user. Restored when the
+    float _userMinSize,_userMaxSize;               //auto tuning loses the markers
+    bool _autoTuning;                              //auto tuning of level and sizes enabled
+    int _tuneMinSide,_tuneFramesToReset;           //auto tuning parameters
+    int _tuneFramesLost;                           //consecutive frames without markers
+    vector<float> _tuneMinSides,_tuneMaxSides;     //marker sides seen in the last frames
+    double _timeBudget;                            //max time per frame in ms (<=0 no limit)
+    CandidatePriority _priority;                   //order of candidates with time budget
+    bool _partial;                                 //time budget expired in last detection
+    vector<Marker> _arraysMarkers;                 //buffer of detect() with MarkerArrays output
+    vector<cv::Point2f> _prevCenters;              //centers of the last markers detected
+    bool _candidateScoring;                        //test candidates before warping
+    float _scoreMinEdgeContrast,_scoreMinInteriorContrast; //thresholds of the test
+    float _scoreMinSideRatio,_scoreMaxCos;
     cv::Mat grey,thres,thres2,reduced;             //Images
     //pointer to the function that analizes a rectangular region so as to detect its internal marker
     int (* markerIdDetector_ptrfunc)(const cv::Mat &in,int &nRotations);
+    Dictionary _dictionary;                        //dictionary employed if _useDictionary
+    bool _useDictionary;
 
     /**
      */
@@ -364,29 +611,47 @@ class ARUCO_EXPORTS  MarkerDetector
 //                         double b1, double b2, double b3 );
 //
 
+    //fast test of a candidate before warping it. Returns false if it can not be a marker
+    bool scoreCandidate(const cv::Mat &grey,const vector<cv::Point2f> &quad);
+
+    //sorts the candidates in the order given by _priority. scale converts the coordinates of
+    //the candidates to the ones of the original image
+    void sortCandidatesByPriority(vector<MarkerCandidate> &candidates,float scale);
+
+    //analyzes the markers detected and sets the pyrdown level and min/max sizes for the next frame
+    void updateAutoTuning(const vector<Marker> &markers,cv::Size imSize);
+
+    //EDGES refinement of the markers, in parallel if USE_OMP is defined
+    void refineCornersEdges(const cv::Mat &grey,vector<Marker> &markers);
+
+    //refines the corners of the markers detected in the reduced image up to the original one
+    void refineCornersCoarseToFine(vector<Marker> &markers);
+
     //detection of the
     void findBestCornerInRegion_harris(const cv::Mat & grey, vector<cv::Point2f> &Corners,
       int blockSize);
 
-    // auxiliar functions to perform LINES refinement
-    void interpolate2Dline( const vector< cv::Point > &inPoints, cv::Point3f &outLine);
-    cv::Point2f getCrossPoint(const cv::Point3f& line1, const cv::Point3f& line2);
+    //sets the cornerIdx of the candidate, that must be the points of its contour in corners
+    void locateCornersInContour(MarkerCandidate &candidate,const vector<cv::Point> &corners);
+
+    //LINES refinement of the candidates indicated, in parallel if USE_OMP is defined
+    void refineCandidatesLines(vector<MarkerCandidate> &candidates,const vector<int> &which);
 
     /**Given a vector vinout with elements and a boolean vector indicating the lements from it
      * to remove, this function remove the elements
-     * @param vinout
+     * @param vinout its elements must have a swap member function
      * @param toRemove
      */
     template<typename T>
     void removeElements(vector<T> & vinout,const vector<bool> &toRemove)
     {
-      //remove the invalid ones by setting the valid in the positions left by the invalids
+      //remove the invalid ones by moving the valid to the positions left by the invalids
       size_t indexValid=0;
       for (size_t i=0; i<toRemove.size(); i++)
       {
         if (!toRemove[i])
         {
-          if (indexValid!=i) vinout[indexValid]=vinout[i];
+          if (indexValid!=i) vinout[indexValid].swap(vinout[i]);
           indexValid++;
         }
       }
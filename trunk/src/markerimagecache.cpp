@@ -0,0 +1,232 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "markerimagecache.h"
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+/*!
+ *  
+ */
+MarkerImageCache::MarkerImageCache(size_t maxBytes,const Dictionary &dictionary)
+{
+  _dictionary=&dictionary;
+  _maxBytes=maxBytes;
+  _bytes=0;
+}
+
+/*!
+ *  
+ */
+cv::Mat MarkerImageCache::renderMarker(const Key &k)const throw (cv::Exception)
+{
+  if (k.margin<0)
+    throw cv::Exception(9001,"invalid margin","MarkerImageCache::renderMarker",__FILE__,__LINE__);
+  if (k.size<=0)
+    throw cv::Exception(9001,"invalid size","MarkerImageCache::renderMarker",__FILE__,__LINE__);
+  Mat marker=_dictionary->createMarkerImage(k.id,k.size);
+  if (k.margin==0) return marker;
+  Mat image(k.size+2*k.margin,k.size+2*k.margin,CV_8UC1);
+  image.setTo(Scalar(255));
+  Mat roi=image(Rect(k.margin,k.margin,k.size,k.size));
+  marker.copyTo(roi);
+  return image;
+}
+
+/*!
+ *  
+ */
+cv::Mat MarkerImageCache::insert(const Key &k,const cv::Mat &image)
+{
+  //it may have been added by other thread while it was being rendered
+  map<Key,Entry>::iterator it=_entries.find(k);
+  if (it!=_entries.end()) return it->second.image;
+  size_t bytes=image.total();
+  //images bigger than the cache are not kept
+  if (bytes>_maxBytes) return image;
+  _lru.push_front(k);
+  Entry &e=_entries[k];
+  e.image=image;
+  e.lru=_lru.begin();
+  _bytes+=bytes;
+  shrink();
+  return image;
+}
+
+/*!
+ *  
+ */
+void MarkerImageCache::shrink()
+{
+  while (_bytes>_maxBytes && !_lru.empty())
+  {
+    map<Key,Entry>::iterator it=_entries.find(_lru.back());
+    _bytes-=it->second.image.total();
+    _entries.erase(it);
+    _lru.pop_back();
+  }
+}
+
+/*!
+ *  
+ */
+cv::Mat MarkerImageCache::get(int id,int size,int margin) throw (cv::Exception)
+{
+  Key k;
+  k.id=id;
+  k.size=size;
+  k.margin=margin;
+  {
+    ScopedLock lock(_mutex);
+    map<Key,Entry>::iterator it=_entries.find(k);
+    if (it!=_entries.end())
+    {
+      //move to the front of the list
+      _lru.splice(_lru.begin(),_lru,it->second.lru);
+      return it->second.image;
+    }
+  }
+  //rendered without the lock, so that other threads are not blocked
+  Mat image=renderMarker(k);
+  ScopedLock lock(_mutex);
+  return insert(k,image);
+}
+
+/*!
+ *  
+ */
+void MarkerImageCache::prefill(const vector<int> &ids,int size,int margin) throw (cv::Exception)
+{
+  //find the ones not in the cache
+  vector<Key> keys;
+  {
+    ScopedLock lock(_mutex);
+    for (size_t i=0; i<ids.size(); i++)
+    {
+      Key k;
+      k.id=ids[i];
+      k.size=size;
+      k.margin=margin;
+      if (_entries.find(k)==_entries.end()) keys.push_back(k);
+    }
+  }
+  //render them. Exceptions must not leave the parallel region, so the arguments are checked
+  //first, and any other error is kept and thrown after the loop
+  for (size_t i=0; i<keys.size(); i++)
+    if (keys[i].id<0 || keys[i].id>=_dictionary->size())
+      throw cv::Exception(9001,"invalid marker id","MarkerImageCache::prefill",__FILE__,__LINE__);
+  if (size<=0)
+    throw cv::Exception(9001,"invalid size","MarkerImageCache::prefill",__FILE__,__LINE__);
+  if (margin<0)
+    throw cv::Exception(9001,"invalid margin","MarkerImageCache::prefill",__FILE__,__LINE__);
+  vector<Mat> images(keys.size());
+  int nKeys=keys.size();
+  vector<char> failed(nKeys,0);
+  vector<cv::Exception> errors(nKeys);
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+  for (int i=0; i<nKeys; i++)
+  {
+    try
+    {
+      images[i]=renderMarker(keys[i]);
+    }
+    catch (cv::Exception &ex)
+    {
+      errors[i]=ex;
+      failed[i]=1;
+    }
+    catch (std::exception &ex)
+    {
+      errors[i]=cv::Exception(9001,ex.what(),"MarkerImageCache::prefill",__FILE__,__LINE__);
+      failed[i]=1;
+    }
+  }
+  for (int i=0; i<nKeys; i++)
+    if (failed[i]) throw errors[i];
+
+  ScopedLock lock(_mutex);
+  for (size_t i=0; i<keys.size(); i++)
+    insert(keys[i],images[i]);
+}
+
+/*!
+ *  
+ */
+void MarkerImageCache::clear()
+{
+  ScopedLock lock(_mutex);
+  _entries.clear();
+  _lru.clear();
+  _bytes=0;
+}
+
+/*!
+ *  
+ */
+void MarkerImageCache::setMaxBytes(size_t maxBytes)
+{
+  ScopedLock lock(_mutex);
+  _maxBytes=maxBytes;
+  shrink();
+}
+
+/*!
+ *  
+ */
+size_t MarkerImageCache::getMaxBytes()const
+{
+  ScopedLock lock(_mutex);
+  return _maxBytes;
+}
+
+/*!
+ *  
+ */
+size_t MarkerImageCache::getBytes()const
+{
+  ScopedLock lock(_mutex);
+  return _bytes;
+}
+
+/*!
+ *  
+ */
+MarkerImageCache & MarkerImageCache::getDefault()
+{
+  static MarkerImageCache cache;
+  return cache;
+}
+
+//the threads of SyntheticFrameGenerator share the default cache, and C++98 does not guard the
+//local static of getDefault(), so it is constructed during the static initialization
+static MarkerImageCache &defaultCache=MarkerImageCache::getDefault();
+
+}
@@ -0,0 +1,138 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_MarkerImageCache_H
+#define _ARUCO_MarkerImageCache_H
+#include <opencv2/core/core.hpp>
+#include <list>
+#include <map>
+#include <vector>
+#include "exports.h"
+#include "dictionary.h"
+#include "mutex.h"
+namespace aruco
+{
+
+/**\brief Thread-safe cache of rendered marker images.
+ *
+ * The images are created as Dictionary::createMarkerImage does, and kept by (id, size, margin)
+ * until the memory employed exceeds the limit indicated. Then, the least recently used ones are
+ * released. The images returned share the data with the cache, so they must not be modified
+ * (clone them if required). They remain valid after being released from the cache.
+ */
+class ARUCO_EXPORTS MarkerImageCache
+{
+  public:
+
+    /**
+     * @param maxBytes max memory employed by the images kept
+     * @param dictionary dictionary of the markers. A copy is not made, so it must exist while
+     * this object is employed
+     */
+    MarkerImageCache(size_t maxBytes=64*1024*1024,
+      const Dictionary &dictionary=Dictionary::getArucoDictionary());
+
+    /**Returns the image of a marker, rendering it if it is not in the cache
+     * @param id id of the marker
+     * @param size size of the marker in pixels, including its black border
+     * @param margin width of the white margin around the marker. The image has size+2*margin
+     * pixels of side
+     */
+    cv::Mat get(int id,int size,int margin=0) throw (cv::Exception);
+
+    /**Renders the images of the markers passed that are not in the cache. They are rendered in
+     * parallel if the library is compiled with USE_OMP
+     */
+    void prefill(const std::vector<int> &ids,int size,int margin=0) throw (cv::Exception);
+
+    /**Releases all the images
+     */
+    void clear();
+
+    /**Sets the max memory employed. Images are released if required
+     */
+    void setMaxBytes(size_t maxBytes);
+
+    /**
+     */
+    size_t getMaxBytes()const;
+
+    /**Memory employed by the images in the cache
+     */
+    size_t getBytes()const;
+
+    /**
+     */
+    const Dictionary & getDictionary()const
+    {
+      return *_dictionary;
+    }
+
+    /**Cache of the markers of the library, with the default size
+     */
+    static MarkerImageCache & getDefault();
+
+  private:
+
+    //not copyable
+    MarkerImageCache(const MarkerImageCache &);
+    MarkerImageCache & operator=(const MarkerImageCache &);
+
+    struct Key
+    {
+      int id,size,margin;
+      bool operator<(const Key &k)const
+      {
+        if (id!=k.id) return id<k.id;
+        if (size!=k.size) return size<k.size;
+        return margin<k.margin;
+      }
+    };
+
+    struct Entry
+    {
+      cv::Mat image;
+      std::list<Key>::iterator lru; //position in _lru
+    };
+
+    cv::Mat renderMarker(const Key &k)const throw (cv::Exception);
+    //adds an image rendered if it is not in the cache yet, and returns the one kept. Must be
+    //called with the mutex locked
+    cv::Mat insert(const Key &k,const cv::Mat &image);
+    //releases the least recently used images until the limit is respected
+    void shrink();
+
+    const Dictionary *_dictionary;
+    size_t _maxBytes,_bytes;
+    std::map<Key,Entry> _entries;
+    std::list<Key> _lru;          //most recently used first
+    mutable Mutex _mutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,207 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "mutex.h"
+#if defined WIN32 || defined _WIN32 || defined WINCE
+//condition variables require Vista
+#if !defined _WIN32_WINNT || _WIN32_WINNT<0x0600
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <windows.h>
+#define ARUCO_WIN32_MUTEX
+#else
+#include <pthread.h>
+#endif
+namespace aruco
+{
+
+#ifdef ARUCO_WIN32_MUTEX
+
+/*!
+ *  
+ */
+Mutex::Mutex()
+{
+  CRITICAL_SECTION *cs=new CRITICAL_SECTION;
+  InitializeCriticalSection(cs);
+  _impl=cs;
+}
+
+/*!
+ *  
+ */
+Mutex::~Mutex()
+{
+  CRITICAL_SECTION *cs=(CRITICAL_SECTION*)_impl;
+  DeleteCriticalSection(cs);
+  delete cs;
+}
+
+/*!
+ *  
+ */
+void Mutex::lock()
+{
+  EnterCriticalSection((CRITICAL_SECTION*)_impl);
+}
+
+/*!
+ *  
+ */
+void Mutex::unlock()
+{
+  LeaveCriticalSection((CRITICAL_SECTION*)_impl);
+}
+
+/*!
+ *  
+ */
+Condition::Condition()
+{
+  CONDITION_VARIABLE *c=new CONDITION_VARIABLE;
+  InitializeConditionVariable(c);
+  _impl=c;
+}
+
+/*!
+ *  
+ */
+Condition::~Condition()
+{
+  delete (CONDITION_VARIABLE*)_impl;
+}
+
+/*!
+ *  
+ */
+void Condition::wait(Mutex &m)
+{
+  SleepConditionVariableCS((CONDITION_VARIABLE*)_impl,(CRITICAL_SECTION*)m._impl,INFINITE);
+}
+
+/*!
+ *  
+ */
+void Condition::signal()
+{
+  WakeConditionVariable((CONDITION_VARIABLE*)_impl);
+}
+
+/*!
+ *  
+ */
+void Condition::broadcast()
+{
+  WakeAllConditionVariable((CONDITION_VARIABLE*)_impl);
+}
+
+#else
+
+/*!
+ *  
+ */
+Mutex::Mutex()
+{
+  pthread_mutex_t *m=new pthread_mutex_t;
+  pthread_mutex_init(m,NULL);
+  _impl=m;
+}
+
+/*!
+ *  
+ */
+Mutex::~Mutex()
+{
+  pthread_mutex_t *m=(pthread_mutex_t*)_impl;
+  pthread_mutex_destroy(m);
+  delete m;
+}
+
+/*!
+ *  
+ */
+void Mutex::lock()
+{
+  pthread_mutex_lock((pthread_mutex_t*)_impl);
+}
+
+/*!
+ *  
+ */
+void Mutex::unlock()
+{
+  pthread_mutex_unlock((pthread_mutex_t*)_impl);
+}
+
+/*!
+ *  
+ */
+Condition::Condition()
+{
+  pthread_cond_t *c=new pthread_cond_t;
+  pthread_cond_init(c,NULL);
+  _impl=c;
+}
+
+/*!
+ *  
+ */
+Condition::~Condition()
+{
+  pthread_cond_t *c=(pthread_cond_t*)_impl;
+  pthread_cond_destroy(c);
+  delete c;
+}
+
+/*!
+ *  
+ */
+void Condition::wait(Mutex &m)
+{
+  pthread_cond_wait((pthread_cond_t*)_impl,(pthread_mutex_t*)m._impl);
+}
+
+/*!
+ *  
+ */
+void Condition::signal()
+{
+  pthread_cond_signal((pthread_cond_t*)_impl);
+}
+
+/*!
+ *  
+ */
+void Condition::broadcast()
+{
+  pthread_cond_broadcast((pthread_cond_t*)_impl);
+}
+
+#endif
+
+}
@@ -0,0 +1,114 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_Mutex_H
+#define _ARUCO_Mutex_H
+#include "exports.h"
+namespace aruco
+{
+
+/**\brief Mutex for the objects of the library shared by several threads. It is implemented with
+ * pthreads or with the Win32 API, so that it can be employed with any threading library
+ */
+class ARUCO_EXPORTS Mutex
+{
+  public:
+
+    Mutex();
+    ~Mutex();
+    void lock();
+    void unlock();
+
+  private:
+
+    //not copyable
+    Mutex(const Mutex &);
+    Mutex & operator=(const Mutex &);
+
+    void *_impl; //pthread_mutex_t or CRITICAL_SECTION
+
+    friend class Condition;
+};
+
+/**\brief Condition variable, employed with a Mutex
+ */
+class ARUCO_EXPORTS Condition
+{
+  public:
+
+    Condition();
+    ~Condition();
+
+    /**Unlocks the mutex, that must be locked, and waits until the condition is signaled. The
+     * mutex is locked again before returning
+     */
+    void wait(Mutex &m);
+
+    /**Wakes up one of the threads waiting
+     */
+    void signal();
+
+    /**Wakes up all the threads waiting
+     */
+    void broadcast();
+
+  private:
+
+    //not copyable
+    Condition(const Condition &);
+    Condition & operator=(const Condition &);
+
+    void *_impl; //pthread_cond_t or CONDITION_VARIABLE
+};
+
+/**\brief Locks a mutex in its scope
+ */
+class ARUCO_EXPORTS ScopedLock
+{
+  public:
+
+    ScopedLock(Mutex &m):_mutex(m)
+    {
+      _mutex.lock();
+    }
+
+    ~ScopedLock()
+    {
+      _mutex.unlock();
+    }
+
+  private:
+
+    ScopedLock(const ScopedLock &);
+    ScopedLock & operator=(const ScopedLock &);
+
+    Mutex &_mutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,339 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "overlayrenderer.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <cstdio>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+//subpixel bits of the lines
+static const int overlayShift=4;
+
+/*!
+ *  
+ */
+OverlayRenderer::OverlayRenderer(const CameraParameters &cp,int elements) throw (cv::Exception)
+{
+  if (!cp.isValid())
+    throw cv::Exception(9001,"invalid camera parameters","OverlayRenderer::OverlayRenderer",
+      __FILE__,__LINE__);
+  _cp=cp;
+  _elements=elements;
+  _pending=_done=_stop=false;
+  _scaleX=_scaleY=1;
+}
+
+/*!
+ *  
+ */
+OverlayRenderer::~OverlayRenderer()
+{
+  _mutex.lock();
+  _stop=true;
+  _changed.broadcast();
+  _mutex.unlock();
+  _thread.join();
+}
+
+/*!
+ * Markers and boards without pose have -999999 in Tvec
+ */
+int OverlayRenderer::addPoints(const Point3f *points,int nPoints,const Mat &Rvec,const Mat &Tvec)
+{
+  if (Rvec.total()!=3 || Tvec.total()!=3) return -1;
+  Mat T;
+  Tvec.reshape(1,3).convertTo(T,CV_32F);
+  Point3f t(T.at<float>(0),T.at<float>(1),T.at<float>(2));
+  if (t.z<=0) return -1;
+  Rodrigues(Rvec,_R);
+  if (_R.type()!=CV_32F) _R.convertTo(_R,CV_32F);
+  const float *r=_R.ptr<float>(0);
+  int first=_points.size();
+  for (int i=0; i<nPoints; i++)
+  {
+    const Point3f &p=points[i];
+    _points.push_back(Point3f(r[0]*p.x+r[1]*p.y+r[2]*p.z+t.x,r[3]*p.x+r[4]*p.y+r[5]*p.z+t.y,
+      r[6]*p.x+r[7]*p.y+r[8]*p.z+t.z));
+  }
+  return first;
+}
+
+/*!
+ * The solids are the ones of CvDrawingUtils: the marker cube stands on the y=0 plane and the
+ * board cube is centered in the z=0 one
+ */
+void OverlayRenderer::addSolid(float axisSize,float cubeSize,bool isBoard,const Mat &Rvec,
+  const Mat &Tvec)
+{
+  if (_elements&AXES)
+  {
+    Point3f axes[4]={Point3f(0,0,0),Point3f(axisSize,0,0),Point3f(0,axisSize,0),
+                     Point3f(0,0,axisSize)};
+    int first=addPoints(axes,4,Rvec,Tvec);
+    if (first<0) return;
+    for (int c=0; c<3; c++)
+    {
+      vector<int> &lines=isBoard?_boardAxisLines[c]:_axisLines[c];
+      lines.push_back(first);
+      lines.push_back(first+1+c);
+    }
+    (isBoard?_boardAxisOrigins:_axisOrigins).push_back(first);
+  }
+  if (_elements&CUBES)
+  {
+    float h=cubeSize/2;
+    Point3f cube[8];
+    for (int i=0; i<4; i++)
+    {
+      //corners of the base and the top, in the same order
+      float a=(i==1 || i==2)?h:-h,b=(i>=2)?h:-h;
+      if (isBoard)
+      {
+        cube[i]=Point3f(a,(i==2 || i==3)?cubeSize:0,-h);
+        cube[i+4]=Point3f(a,(i==2 || i==3)?cubeSize:0,h);
+      }
+      else
+      {
+        cube[i]=Point3f(a,0,b);
+        cube[i+4]=Point3f(a,cubeSize,b);
+      }
+    }
+    int first=addPoints(cube,8,Rvec,Tvec);
+    if (first<0) return;
+    for (int i=0; i<4; i++)
+    {
+      int edges[3][2]={{i,(i+1)%4},{i+4,4+(i+1)%4},{i,i+4}};
+      for (int e=0; e<3; e++)
+      {
+        _cubeLines.push_back(first+edges[e][0]);
+        _cubeLines.push_back(first+edges[e][1]);
+      }
+    }
+  }
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::drawLines(Mat &image,const vector<int> &lines,Scalar color,int width,
+  bool closed)
+{
+  if (lines.empty()) return;
+  //each line is a polyline of two points (four if closed). The pointers are set after filling
+  //the points, since the vector may be reallocated. The scale of the preview is applied here
+  int nPoints=closed?4:2;
+  float sx=_scaleX*(1<<overlayShift),sy=_scaleY*(1<<overlayShift);
+  _linePoints.resize(lines.size());
+  for (size_t i=0; i<lines.size(); i++)
+  {
+    const Point2f &p=_projected[lines[i]];
+    _linePoints[i]=Point(cvRound(p.x*sx),cvRound(p.y*sy));
+  }
+  int nLines=lines.size()/nPoints;
+  _linePtrs.resize(nLines);
+  _lineSizes.assign(nLines,nPoints);
+  for (int i=0; i<nLines; i++) _linePtrs[i]=&_linePoints[i*nPoints];
+  polylines(image,&_linePtrs[0],&_lineSizes[0],nLines,closed,color,width,CV_AA,overlayShift);
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::draw(Mat &image,const vector<Marker> &markers,const vector<Board> &boards)
+{
+  render(image,markers,boards,1,1);
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::drawPreview(const Mat &image,Mat &preview,Size previewSize,
+  const vector<Marker> &markers,const vector<Board> &boards)
+{
+  createPreview(image,preview,previewSize);
+  render(preview,markers,boards,float(previewSize.width)/image.cols,
+    float(previewSize.height)/image.rows);
+}
+
+/*!
+ * Bilinear and nearest neighbour interpolations only read the pixels around each one of the
+ * preview, unlike the area interpolation
+ */
+void OverlayRenderer::createPreview(const Mat &image,Mat &preview,Size previewSize,bool isBinary,
+  bool toColor)
+{
+  Mat small;
+  resize(image,small,previewSize,0,0,isBinary?INTER_NEAREST:INTER_LINEAR);
+  if (toColor && small.channels()==1) cvtColor(small,preview,CV_GRAY2BGR);
+  else preview=small;
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::render(Mat &image,const vector<Marker> &markers,const vector<Board> &boards,
+  float scaleX,float scaleY)
+{
+  _scaleX=scaleX;
+  _scaleY=scaleY;
+  _points.clear();
+  _outlines.clear();
+  _cubeLines.clear();
+  _axisOrigins.clear();
+  _boardAxisOrigins.clear();
+  for (int c=0; c<3; c++)
+  {
+    _axisLines[c].clear();
+    _boardAxisLines[c].clear();
+  }
+  for (size_t i=0; i<markers.size(); i++)
+    if (markers[i].ssize>0)
+      addSolid(markers[i].ssize*3,markers[i].ssize,false,markers[i].Rvec,markers[i].Tvec);
+  for (size_t i=0; i<boards.size(); i++)
+    if (!boards[i].empty() && boards[i][0].ssize>0)
+      addSolid(2*boards[i][0].ssize,boards[i][0].ssize,true,boards[i].Rvec,boards[i].Tvec);
+
+  //all the points are already in the camera reference system
+  _projected.clear();
+  if (!_points.empty())
+  {
+    Mat zero=Mat::zeros(3,1,CV_32F);
+    _cp.projectPoints(Mat(_points),zero,zero,_projected);
+  }
+  //the corners of the markers are added to the projected points
+  if (_elements&OUTLINES)
+    for (size_t i=0; i<markers.size(); i++)
+      if (markers[i].size()==4)
+        for (int c=0; c<4; c++)
+        {
+          _outlines.push_back(_projected.size());
+          _projected.push_back(markers[i][c]);
+        }
+  if (_projected.empty()) return;
+
+  const Scalar colors[3]={Scalar(0,0,255,255),Scalar(0,255,0,255),Scalar(255,0,0,255)};
+  drawLines(image,_cubeLines,colors[0],1);
+  for (int c=0; c<3; c++)
+  {
+    drawLines(image,_axisLines[c],colors[c],1);
+    drawLines(image,_boardAxisLines[c],colors[c],2);
+  }
+  drawLines(image,_outlines,colors[0],1,true);
+  if (_elements&OUTLINES)
+    for (size_t i=0; i<markers.size(); i++)
+      if (markers[i].size()==4)
+      {
+        char cad[100];
+        sprintf(cad,"id=%d",markers[i].id);
+        putText(image,cad,toPixel(markers[i].getCenter()),FONT_HERSHEY_SIMPLEX,0.5,
+          Scalar(255,255,0,255),2);
+      }
+  if (_elements&LABELS)
+  {
+    const char *labels[3]={"x","y","z"},*boardLabels[3]={"X","Y","Z"};
+    for (size_t i=0; i<_axisOrigins.size(); i++)
+      for (int c=0; c<3; c++)
+        putText(image,labels[c],toPixel(_projected[_axisOrigins[i]+1+c]),FONT_HERSHEY_SIMPLEX,0.6,
+          colors[c],2);
+    for (size_t i=0; i<_boardAxisOrigins.size(); i++)
+      for (int c=0; c<3; c++)
+        putText(image,boardLabels[c],toPixel(_projected[_boardAxisOrigins[i]+1+c]),
+          FONT_HERSHEY_SIMPLEX,1,colors[c],2);
+  }
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::drawAsync(const Mat &image,const vector<Marker> &markers,
+  const vector<Board> &boards) throw (cv::Exception)
+{
+  if (!_thread.isRunning()) _thread.start(threadMain,this);
+  ScopedLock lock(_mutex);
+  while (_pending) _changed.wait(_mutex);
+  //only the header is copied. The thread copies the data
+  _asyncInput=image;
+  _asyncMarkers=markers;
+  _asyncBoards=boards;
+  _pending=true;
+  _done=false;
+  _changed.broadcast();
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::getResult(Mat &result) throw (cv::Exception)
+{
+  ScopedLock lock(_mutex);
+  if (!_pending && !_done)
+    throw cv::Exception(9001,"no frame has been passed to drawAsync","OverlayRenderer::getResult",
+      __FILE__,__LINE__);
+  while (_pending) _changed.wait(_mutex);
+  result=_asyncResult;
+  _asyncResult=Mat();
+  _done=false;
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::threadMain(void *renderer)
+{
+  ((OverlayRenderer*)renderer)->run();
+}
+
+/*!
+ *  
+ */
+void OverlayRenderer::run()
+{
+  _mutex.lock();
+  while (true)
+  {
+    while (!_pending && !_stop) _changed.wait(_mutex);
+    if (_stop) break;
+    //the input is not modified by drawAsync while _pending is set, so it is used unlocked
+    _mutex.unlock();
+    Mat result;
+    _asyncInput.copyTo(result);
+    draw(result,_asyncMarkers,_asyncBoards);
+    _mutex.lock();
+    _asyncResult=result;
+    _asyncInput=Mat();
+    _pending=false;
+    _done=true;
+    _changed.broadcast();
+  }
+  _mutex.unlock();
+}
+
+}
@@ -0,0 +1,189 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_OverlayRenderer_H
+#define _ARUCO_OverlayRenderer_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "exports.h"
+#include "marker.h"
+#include "board.h"
+#include "cameraparameters.h"
+#include "mutex.h"
+#include "thread.h"
+namespace aruco
+{
+
+/**\brief Draws the 3D axes and cubes of the markers and boards of a frame, as CvDrawingUtils,
+ * in a batch.
+ *
+ * The points of all the markers are transformed to the camera reference system and projected
+ * with a single call to cv::projectPoints, and all the lines of the same colour and width are
+ * drawn with a single call to cv::polylines. The buffers are kept between frames, so that
+ * nothing is allocated once they have grown.
+ *
+ * For low resolution monitoring, drawPreview() draws the overlay on a downscaled copy of the
+ * frame, scaling the points when they are converted to pixels, so that the cost depends on the
+ * size of the preview and not on the size of the frame.
+ *
+ * The overlay can also be drawn in a background thread with drawAsync(): the frame is not copied
+ * by the caller, but by the thread, which draws on the copy. The caller must not modify the frame
+ * until getResult() returns.
+ */
+class ARUCO_EXPORTS OverlayRenderer
+{
+  public:
+
+    /**Elements drawn
+     */
+    enum Elements {AXES=1,CUBES=2,LABELS=4,OUTLINES=8};
+
+    /**
+     * @param cp camera parameters
+     * @param elements combination of Elements drawn. OUTLINES draws the sides and the id of the
+     * markers, as Marker::draw
+     */
+    OverlayRenderer(const CameraParameters &cp,int elements=AXES|CUBES|LABELS)
+      throw (cv::Exception);
+
+    /**Stops the background thread, if any
+     */
+    ~OverlayRenderer();
+
+    /**
+     */
+    void setElements(int elements)
+    {
+      _elements=elements;
+    }
+
+    /**
+     */
+    int getElements()const
+    {
+      return _elements;
+    }
+
+    /**Draws the markers and boards with valid poses
+     * @param image image where the overlay is drawn
+     * @param markers markers. Their axes and cubes have the sizes of CvDrawingUtils
+     * @param boards boards. Their axes and cubes have the sizes of CvDrawingUtils
+     */
+    void draw(cv::Mat &image,const std::vector<Marker> &markers,
+      const std::vector<Board> &boards=std::vector<Board>());
+
+    /**Draws the overlay on a downscaled copy of the image
+     * @param image frame
+     * @param preview output. See createPreview
+     * @param previewSize size of the preview
+     * @param markers markers detected in the frame
+     * @param boards boards detected in the frame
+     */
+    void drawPreview(const cv::Mat &image,cv::Mat &preview,cv::Size previewSize,
+      const std::vector<Marker> &markers,const std::vector<Board> &boards=std::vector<Board>());
+
+    /**Creates a downscaled copy of an image (e.g. MarkerDetector::getThresholdedImage()), reading
+     * only the pixels required by the preview
+     * @param image input image
+     * @param preview output. It is converted to BGR if the image is grey and toColor is set
+     * @param previewSize size of the preview
+     * @param isBinary if set, the pixels are not interpolated, so that a thresholded image remains
+     * binary
+     * @param toColor indicates whether grey images are converted to BGR (after downscaling)
+     */
+    static void createPreview(const cv::Mat &image,cv::Mat &preview,cv::Size previewSize,
+      bool isBinary=false,bool toColor=true);
+
+    /**Starts drawing a copy of the frame in a background thread. Only one frame can be drawn at a
+     * time, so it waits for the previous one, that is lost if getResult() has not been called.
+     * draw() must not be called until getResult() returns.
+     * @param image frame. It is not copied here, so it must not be modified until getResult()
+     * returns
+     * @param markers markers
+     * @param boards boards
+     */
+    void drawAsync(const cv::Mat &image,const std::vector<Marker> &markers,
+      const std::vector<Board> &boards=std::vector<Board>()) throw (cv::Exception);
+
+    /**Waits until the frame passed to drawAsync() is drawn and returns it
+     */
+    void getResult(cv::Mat &result) throw (cv::Exception);
+
+  private:
+
+    //not copyable
+    OverlayRenderer(const OverlayRenderer &);
+    OverlayRenderer & operator=(const OverlayRenderer &);
+
+    //adds the points of a solid, transformed by a pose, to _points. Returns the index of the
+    //first one, or -1 if the pose is not valid
+    int addPoints(const cv::Point3f *points,int nPoints,const cv::Mat &Rvec,const cv::Mat &Tvec);
+    //adds the axes and the cube of a solid of the size indicated
+    void addSolid(float axisSize,float cubeSize,bool isBoard,const cv::Mat &Rvec,
+      const cv::Mat &Tvec);
+    //draws a set of lines, given by pairs of indices of projected points, in a single call
+    void drawLines(cv::Mat &image,const std::vector<int> &lines,cv::Scalar color,int width,
+      bool closed=false);
+    //draws the overlay, scaling the points by the factors indicated
+    void render(cv::Mat &image,const std::vector<Marker> &markers,const std::vector<Board> &boards,
+      float scaleX,float scaleY);
+    //pixel of a projected point
+    cv::Point toPixel(const cv::Point2f &p)const
+    {
+      return cv::Point(cvRound(p.x*_scaleX),cvRound(p.y*_scaleY));
+    }
+
+    static void threadMain(void *renderer);
+    void run();
+
+    CameraParameters _cp;
+    int _elements;
+    //buffers reused between frames
+    std::vector<cv::Point3f> _points;       //points in camera coordinates
+    std::vector<cv::Point2f> _projected;
+    std::vector<int> _axisLines[3],_boardAxisLines[3],_cubeLines; //pairs of indices of points
+    std::vector<int> _outlines;                       //indices of the corners of the markers
+    std::vector<int> _axisOrigins,_boardAxisOrigins;  //first point of each axes, for the labels
+    std::vector<cv::Point> _linePoints;
+    std::vector<const cv::Point*> _linePtrs;
+    std::vector<int> _lineSizes;
+    cv::Mat _R;
+    float _scaleX,_scaleY;                            //scale of the points being drawn
+
+    //background drawing
+    Thread _thread;
+    Mutex _mutex;
+    Condition _changed;
+    bool _pending,_done,_stop;
+    cv::Mat _asyncInput,_asyncResult;
+    std::vector<Marker> _asyncMarkers;
+    std::vector<Board> _asyncBoards;
+};
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "posecache.h"
+#include <cmath>
+#include <opencv2/calib3d/calib3d.hpp>
+using namespace cv;
+namespace aruco
+{
+
+/*!
+ *  
+ */
+PoseCache::PoseCache()
+{
+  _valid=false;
+}
+
+/*!
+ *  
+ */
+void PoseCache::update(const cv::Mat &Rvec,const cv::Mat &Tvec)throw(cv::Exception)
+{
+  if (Rvec.type()!=CV_32FC1 || Tvec.type()!=CV_32FC1 || Rvec.total()!=3 || Tvec.total()!=3 ||
+      !Rvec.isContinuous() || !Tvec.isContinuous())
+    throw cv::Exception(9003,"invalid extrinsic parameters","PoseCache::update",
+      __FILE__,__LINE__);
+
+  const float *r=Rvec.ptr<float>(0),*t=Tvec.ptr<float>(0);
+  if (_valid && r[0]==_rvec[0] && r[1]==_rvec[1] && r[2]==_rvec[2] &&
+      t[0]==_tvec[0] && t[1]==_tvec[1] && t[2]==_tvec[2])
+    return;
+
+  _valid=false;
+  Mat Rot(3,3,CV_32FC1);
+  Rodrigues(Rvec, Rot);
+  for (int i=0; i<3; i++)
+  {
+    for (int j=0; j<3; j++) _rot[i*3+j]=Rot.at<float>(i,j);
+    _trans[i]=t[i];
+    _rvec[i]=r[i];
+    _tvec[i]=t[i];
+  }
+  computeOgreOrientation();
+  _valid=true;
+}
+
+/*!
+ *  
+ */
+void PoseCache::glGetModelViewMatrix(double modelview_matrix[16])const
+{
+  // R1
+  modelview_matrix[0 + 0*4] = _rot[0];
+  modelview_matrix[0 + 1*4] = _rot[1];
+  modelview_matrix[0 + 2*4] = _rot[2];
+  modelview_matrix[0 + 3*4] = _trans[0];
+  // R2
+  modelview_matrix[1 + 0*4] = _rot[3];
+  modelview_matrix[1 + 1*4] = _rot[4];
+  modelview_matrix[1 + 2*4] = _rot[5];
+  modelview_matrix[1 + 3*4] = _trans[1];
+  // R3
+  modelview_matrix[2 + 0*4] = -_rot[6];
+  modelview_matrix[2 + 1*4] = -_rot[7];
+  modelview_matrix[2 + 2*4] = -_rot[8];
+  modelview_matrix[2 + 3*4] = -_trans[2];
+  modelview_matrix[3 + 0*4] = 0.0;
+  modelview_matrix[3 + 1*4] = 0.0;
+  modelview_matrix[3 + 2*4] = 0.0;
+  modelview_matrix[3 + 3*4] = 1.0;
+}
+
+/*!
+ *  
+ */
+void PoseCache::OgreGetPoseParameters(double position[3], double orientation[4])const
+{
+  position[0] = -_trans[0];
+  position[1] = -_trans[1];
+  position[2] = +_trans[2];
+  for (int i=0; i<4; i++) orientation[i]=_quat[i];
+}
+
+/*!
+ *  
+ */
+void PoseCache::computeOgreOrientation()
+{
+  double *orientation=_quat;
+  // calculate axes for quaternion
+  double stAxes[3][3];
+  // x axis
+  stAxes[0][0] = -_rot[0];
+  stAxes[0][1] = -_rot[3];
+  stAxes[0][2] = +_rot[6];
+  // y axis
+  stAxes[1][0] = -_rot[1];
+  stAxes[1][1] = -_rot[4];
+  stAxes[1][2] = +_rot[7];
+  // for z axis, we use cross product
+  stAxes[2][0] = stAxes[0][1]*stAxes[1][2] - stAxes[0][2]*stAxes[1][1];
+  stAxes[2][1] = - stAxes[0][0]*stAxes[1][2] + stAxes[0][2]*stAxes[1][0];
+  stAxes[2][2] = stAxes[0][0]*stAxes[1][1] - stAxes[0][1]*stAxes[1][0];
+
+  // transposed matrix
+  double axes[3][3];
+  for (int i=0; i<3; i++)
+    for (int j=0; j<3; j++)
+      axes[j][i] = stAxes[i][j];
+
+  // Algorithm in Ken Shoemake's article in 1987 SIGGRAPH course notes
+  // article "Quaternion Calculus and Fast Animation".
+  double fTrace = axes[0][0]+axes[1][1]+axes[2][2];
+  double fRoot;
+
+  if ( fTrace > 0.0 )
+  {
+    // |w| > 1/2, may as well choose w > 1/2
+    fRoot = sqrt(fTrace + 1.0);  // 2w
+    orientation[0] = 0.5*fRoot;
+    fRoot = 0.5/fRoot;  // 1/(4w)
+    orientation[1] = (axes[2][1]-axes[1][2])*fRoot;
+    orientation[2] = (axes[0][2]-axes[2][0])*fRoot;
+    orientation[3] = (axes[1][0]-axes[0][1])*fRoot;
+  }
+  else
+  {
+    // |w| <= 1/2
+    static unsigned int s_iNext[3] = { 1, 2, 0 };
+    unsigned int i = 0;
+    if ( axes[1][1] > axes[0][0] )
+      i = 1;
+    if ( axes[2][2] > axes[i][i] )
+      i = 2;
+    unsigned int j = s_iNext[i];
+    unsigned int k = s_iNext[j];
+
+    fRoot = sqrt(axes[i][i]-axes[j][j]-axes[k][k] + 1.0);
+    double* apkQuat[3] = { &orientation[1], &orientation[2], &orientation[3] };
+    *apkQuat[i] = 0.5*fRoot;
+    fRoot = 0.5/fRoot;
+    orientation[0] = (axes[k][j]-axes[j][k])*fRoot;
+    *apkQuat[j] = (axes[j][i]+axes[i][j])*fRoot;
+    *apkQuat[k] = (axes[k][i]+axes[i][k])*fRoot;
+  }
+}
+
+}
@@ -0,0 +1,86 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_PoseCache_H
+#define _ARUCO_PoseCache_H
+#include <opencv2/core/core.hpp>
+#include "exports.h"
+namespace aruco
+{
+
+/**\brief Rotation matrix and quaternion of a pose given as Rvec and Tvec.
+ *
+ * The values are computed only when the vectors passed to update() differ from the ones of the
+ * previous call, so the GL and Ogre accessors of Marker and Board can be called once per frame
+ * (or several times per frame) paying for cv::Rodrigues only once per pose.
+ */
+class ARUCO_EXPORTS PoseCache
+{
+  public:
+
+    /**Creates an empty cache
+     */
+    PoseCache();
+
+    /**Updates the cache with the pose indicated, if it has changed
+     * @param Rvec 3x1 rotation vector (CV_32FC1)
+     * @param Tvec 3x1 translation vector (CV_32FC1)
+     */
+    void update(const cv::Mat &Rvec,const cv::Mat &Tvec)throw(cv::Exception);
+
+    /**Returns the 3x3 rotation matrix, row by row
+     */
+    const double *getRotation()const {return _rot;}
+
+    /**Returns the translation vector
+     */
+    const double *getTranslation()const {return _trans;}
+
+    /**Returns the orientation quaternion (w,x,y,z) in the Ogre reference system
+     */
+    const double *getOgreOrientation()const {return _quat;}
+
+    /**Returns the GL_MODELVIEW matrix of the pose. See Marker::glGetModelViewMatrix
+     */
+    void glGetModelViewMatrix(double modelview_matrix[16])const;
+
+    /**Returns position vector and orientation quaternion. See Marker::OgreGetPoseParameters
+     */
+    void OgreGetPoseParameters(double position[3], double orientation[4])const;
+
+  private:
+    bool _valid;
+    float _rvec[3],_tvec[3];//vectors employed for the values below
+    double _rot[9];
+    double _trans[3];
+    double _quat[4];
+
+    void computeOgreOrientation();
+};
+
+}
+#endif
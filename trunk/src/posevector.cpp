@@ -0,0 +1,125 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "posevector.h"
+#include <algorithm>
+using namespace cv;
+namespace aruco
+{
+
+/*!
+ *  
+ */
+#ifdef ARUCO_INLINE_POSE
+PoseVector::PoseVector():Mat(3,1,CV_32FC1,_data)
+#else
+PoseVector::PoseVector():Mat(3,1,CV_32FC1)
+#endif
+{
+  float *v=ptr<float>(0);
+  v[0]=v[1]=v[2]=-999999;
+}
+
+/*!
+ *  
+ */
+#ifdef ARUCO_INLINE_POSE
+PoseVector::PoseVector(const PoseVector &v):Mat(3,1,CV_32FC1,_data)
+#else
+PoseVector::PoseVector(const PoseVector &v):Mat()
+#endif
+{
+  assign(v);
+}
+
+/*!
+ *  
+ */
+PoseVector & PoseVector::operator=(const PoseVector &v)
+{
+  if (&v!=this) assign(v);
+  return *this;
+}
+
+/*!
+ *  
+ */
+PoseVector & PoseVector::operator=(const cv::Mat &m)
+{
+  if (&m!=this) assign(m);
+  return *this;
+}
+
+/*!
+ *  
+ */
+void PoseVector::swap(PoseVector &v)
+{
+#ifdef ARUCO_INLINE_POSE
+  if (isInline() && v.isInline())
+  {
+    for (int i=0; i<3; i++) std::swap(_data[i],v._data[i]);
+    return;
+  }
+  PoseVector aux(*this);
+  *this=v;
+  v=aux;
+#else
+  //the headers are exchanged, so that no data is copied nor allocated
+  Mat aux=*this;
+  Mat::operator=(v);
+  v.Mat::operator=(aux);
+#endif
+}
+
+/*!
+ *  
+ */
+void PoseVector::assign(const cv::Mat &m)
+{
+  if (m.total()!=3 || m.channels()!=1 || !m.isContinuous())
+  {
+    Mat::operator=(m);
+    return;
+  }
+#ifdef ARUCO_INLINE_POSE
+  //back to the inner storage (m keeps its own reference if it shared our previous data)
+  if (!isInline()) Mat::operator=(Mat(3,1,CV_32FC1,_data));
+#else
+  //new data, so that the matrices sharing the previous one keep their values
+  Mat::operator=(Mat(3,1,CV_32FC1));
+#endif
+  float *dst=ptr<float>(0);
+  if (m.type()==CV_32FC1)
+  {
+    const float *src=m.ptr<float>(0);
+    for (int i=0; i<3; i++) dst[i]=src[i];
+  }
+  else m.reshape(1,3).convertTo(*this,CV_32F);
+}
+
+}
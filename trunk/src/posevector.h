@@ -0,0 +1,101 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_PoseVector_H
+#define _ARUCO_PoseVector_H
+#include <opencv2/core/core.hpp>
+#include "exports.h"
+namespace aruco
+{
+
+/**\brief 3x1 CV_32FC1 matrix employed for the Rvec and Tvec of Marker and Board.
+ *
+ * It is a cv::Mat, so it can be passed wherever a matrix is expected. Unlike cv::Mat, copies and
+ * assignments copy the values instead of sharing the data, and the values of a copy are not
+ * changed by later assignments to the original. Initially, all the values are -999999 (i.e., pose
+ * not set).
+ *
+ * By default, the data is allocated as in any cv::Mat, so that a cv::Mat taken from it (e.g.,
+ * cv::Mat r=marker.Rvec) keeps its own reference and remains valid when the marker is destroyed or
+ * moved.
+ *
+ * If the library is built with the ARUCO_INLINE_POSE option, the data is stored inside the object,
+ * so that creating and copying markers (what the detector does for every candidate) does not
+ * allocate memory. Then, a cv::Mat taken from the vector points into the object, and it is not
+ * valid after the object is destroyed or moved (e.g. when a std::vector<Marker> grows): clone()
+ * it to keep it. If a function reallocates the vector (e.g. reading a different type or size into
+ * it), it behaves as a regular cv::Mat from then on, until a 3 elements matrix is assigned again.
+ * The same option must be defined in the programs that use the library.
+ */
+class ARUCO_EXPORTS PoseVector: public cv::Mat
+{
+  public:
+
+    /**Creates the vector with its values set to -999999
+     */
+    PoseVector();
+
+    /**Copies the values of the vector passed
+     */
+    PoseVector(const PoseVector &v);
+
+    /**Copies the values of the vector passed
+     */
+    PoseVector & operator=(const PoseVector &v);
+
+    /**Copies the values of the matrix passed (converted to float) if it has 3 elements.
+     * Otherwise (e.g., an empty matrix) the data is shared as cv::Mat does
+     */
+    PoseVector & operator=(const cv::Mat &m);
+
+    using cv::Mat::operator=;
+
+    /**Exchanges the values with the vector passed
+     */
+    void swap(PoseVector &v);
+
+    /**Indicates whether the data is stored inside this object (only with ARUCO_INLINE_POSE)
+     */
+    bool isInline()const
+    {
+#ifdef ARUCO_INLINE_POSE
+      return data==(const uchar*)_data;
+#else
+      return false;
+#endif
+    }
+
+  private:
+#ifdef ARUCO_INLINE_POSE
+    float _data[3];
+#endif
+
+    void assign(const cv::Mat &m);
+};
+
+}
+#endif
@@ -0,0 +1,494 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "rigdetector.h"
+#include <cmath>
+#include <cstdio>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+namespace
+{
+
+/*!
+ * Composes the pose of the board in the rig with the pose of a camera (rotation matrix Rc and
+ * translation tc), obtaining the pose of the board respect to the camera
+ */
+void composePose(const double rvec[3],const double tvec[3],const double *Rc,const double *tc,
+  Mat &rvecCam,Mat &tvecCam)
+{
+  Mat Rb(3,3,CV_64FC1);
+  Rodrigues(Mat(3,1,CV_64FC1,(void*)rvec),Rb);
+  Mat R(3,3,CV_64FC1);
+  tvecCam.create(3,1,CV_64FC1);
+  for (int i=0; i<3; i++)
+  {
+    for (int j=0; j<3; j++)
+    {
+      double sum=0;
+      for (int k=0; k<3; k++) sum+=Rc[i*3+k]*Rb.at<double>(k,j);
+      R.at<double>(i,j)=sum;
+    }
+    tvecCam.at<double>(i,0)=Rc[i*3]*tvec[0]+Rc[i*3+1]*tvec[1]+Rc[i*3+2]*tvec[2]+tc[i];
+  }
+  Rodrigues(R,rvecCam);
+}
+
+/*!
+ * Reads a 3 elements vector from a sequence node
+ */
+void readVector3(const FileNode &node,double v[3],const string &path)throw(cv::Exception)
+{
+  if (node.size()!=3)
+    throw cv::Exception(9001,"invalid rvec or tvec in rig file:"+path,"RigDetector::readRigFile",
+      __FILE__,__LINE__);
+  for (int i=0; i<3; i++) v[i]=(double)node[i];
+}
+
+/*!
+ * Returns the directory of a path, including the last separator (empty if none)
+ */
+string getDirectory(const string &path)
+{
+  size_t pos=path.find_last_of("/\\");
+  if (pos==string::npos) return "";
+  return path.substr(0,pos+1);
+}
+
+}
+
+/*!
+ *  
+ */
+RigDetector::RigDetector(bool setYPerperdicular)
+{
+  _setYPerperdicular=setYPerperdicular;
+  _markerSize=-1;
+  _poseValid=false;
+  _rmsError=-1;
+}
+
+/*!
+ *  
+ */
+void RigDetector::setCameras(const vector<CameraParameters> &cameras,const vector<Mat> &Rvecs,
+  const vector<Mat> &Tvecs)throw(cv::Exception)
+{
+  if (cameras.size()!=Rvecs.size() || cameras.size()!=Tvecs.size())
+    throw cv::Exception(9001,"the number of cameras and poses differ","RigDetector::setCameras",
+      __FILE__,__LINE__);
+  size_t n=cameras.size();
+  for (size_t c=0; c<n; c++)
+  {
+    if (!cameras[c].isValid())
+      throw cv::Exception(9001,"invalid camera parameters","RigDetector::setCameras",
+        __FILE__,__LINE__);
+    if (Rvecs[c].total()!=3 || Tvecs[c].total()!=3)
+      throw cv::Exception(9001,"invalid camera pose","RigDetector::setCameras",__FILE__,__LINE__);
+  }
+
+  _cameras=cameras;
+  _camR.resize(9*n);
+  _camT.resize(3*n);
+  for (size_t c=0; c<n; c++)
+  {
+    Mat rvec,tvec,R;
+    Rvecs[c].reshape(1,3).convertTo(rvec,CV_64F);
+    Tvecs[c].reshape(1,3).convertTo(tvec,CV_64F);
+    Rodrigues(rvec,R);
+    for (int i=0; i<3; i++)
+    {
+      for (int j=0; j<3; j++) _camR[c*9+i*3+j]=R.at<double>(i,j);
+      _camT[c*3+i]=tvec.at<double>(i,0);
+    }
+  }
+  _mdetectors.resize(n);
+  _bdetectors.assign(n,BoardDetector(false));
+  _markers.resize(n);
+  _boards.resize(n);
+  _objPoints.resize(n);
+  _imgPoints.resize(n);
+  _poseValid=false;
+}
+
+/*!
+ *  
+ */
+void RigDetector::readRigFile(const string &path)throw(cv::Exception)
+{
+  FileStorage fs(path,FileStorage::READ);
+  if (fs["aruco_rig_ncameras"].name()!="aruco_rig_ncameras")
+    throw cv::Exception(9001,"invalid rig file:"+path,"RigDetector::readRigFile",
+      __FILE__,__LINE__);
+  int n=0;
+  fs["aruco_rig_ncameras"]>>n;
+  FileNode nodes=fs["aruco_rig_cameras"];
+  if (n<=0 || int(nodes.size())!=n)
+    throw cv::Exception(9001,"invalid number of cameras in rig file:"+path,
+      "RigDetector::readRigFile",__FILE__,__LINE__);
+
+  vector<CameraParameters> cameras(n);
+  vector<Mat> Rvecs(n),Tvecs(n);
+  string dir=getDirectory(path);
+  int c=0;
+  for (FileNodeIterator it=nodes.begin(); it!=nodes.end(); ++it,c++)
+  {
+    string intrinsics=(string)(*it)["intrinsics"];
+    //relative paths are relative to the rig file
+    if (!intrinsics.empty() && intrinsics[0]!='/' && intrinsics[0]!='\\' &&
+        intrinsics.find(':')==string::npos)
+      intrinsics=dir+intrinsics;
+    cameras[c].readFromXMLFile(intrinsics);
+    double rvec[3],tvec[3];
+    readVector3((*it)["rvec"],rvec,path);
+    readVector3((*it)["tvec"],tvec,path);
+    Mat(3,1,CV_64FC1,rvec).copyTo(Rvecs[c]);
+    Mat(3,1,CV_64FC1,tvec).copyTo(Tvecs[c]);
+  }
+  setCameras(cameras,Rvecs,Tvecs);
+}
+
+/*!
+ *  
+ */
+void RigDetector::saveRigFile(const string &path,vector<string> intrinsicsFiles)
+  throw(cv::Exception)
+{
+  string dir=getDirectory(path);
+  string base=path.substr(dir.size());
+  if (base.find('.')!=string::npos) base=base.substr(0,base.find_last_of('.'));
+  intrinsicsFiles.resize(_cameras.size());
+  for (size_t c=0; c<_cameras.size(); c++)
+  {
+    if (intrinsicsFiles[c].empty())
+    {
+      char name[32];
+      sprintf(name,"_cam%d.yml",int(c));
+      intrinsicsFiles[c]=base+name;
+      _cameras[c].saveToFile(dir+intrinsicsFiles[c]);
+    }
+    else _cameras[c].saveToFile(intrinsicsFiles[c]);
+  }
+
+  FileStorage fs(path,FileStorage::WRITE);
+  fs<<"aruco_rig_ncameras"<<int(_cameras.size());
+  fs<<"aruco_rig_cameras"<<"[";
+  for (size_t c=0; c<_cameras.size(); c++)
+  {
+    Mat rvec,tvec;
+    getCameraPose(c,rvec,tvec);
+    fs<<"{:"<<"intrinsics"<<intrinsicsFiles[c];
+    fs<<"rvec"<<"[:"<<rvec.at<double>(0)<<rvec.at<double>(1)<<rvec.at<double>(2)<<"]";
+    fs<<"tvec"<<"[:"<<tvec.at<double>(0)<<tvec.at<double>(1)<<tvec.at<double>(2)<<"]";
+    fs<<"}";
+  }
+  fs<<"]";
+}
+
+/*!
+ *  
+ */
+void RigDetector::getCameraPose(int cam,Mat &Rvec,Mat &Tvec)const
+{
+  Mat R(3,3,CV_64FC1,(void*)&_camR[cam*9]);
+  Rodrigues(R,Rvec);
+  Mat(3,1,CV_64FC1,(void*)&_camT[cam*3]).copyTo(Tvec);
+}
+
+/*!
+ *  
+ */
+void RigDetector::setBoardConfiguration(const BoardConfiguration &bc,float markerSizeMeters)
+{
+  _bconf=bc;
+  _markerSize=markerSizeMeters;
+  _poseValid=false;
+}
+
+/*!
+ *  
+ */
+float RigDetector::detect(const vector<Mat> &frames)throw(cv::Exception)
+{
+  if (frames.size()!=_cameras.size() || _cameras.empty())
+    throw cv::Exception(9001,"one frame per camera is required","RigDetector::detect",
+      __FILE__,__LINE__);
+  if (_bconf.size()==0 || _bconf[0].size()<2)
+    throw cv::Exception(9001,"the board configuration is not set","RigDetector::detect",
+      __FILE__,__LINE__);
+  for (size_t c=0; c<frames.size(); c++)
+    if (frames[c].empty())
+      throw cv::Exception(9001,"empty frame","RigDetector::detect",__FILE__,__LINE__);
+
+  //the board is expressed in meters for the pose estimation
+  double metersPerUnit=1;
+  if (_bconf.mInfoType==BoardConfiguration::PIX)
+    metersPerUnit=_markerSize>0?_markerSize/norm(_bconf[0][0]-_bconf[0][1]):-1;
+
+  //markers of each camera, one camera per thread. An exception can not leave the parallel
+  //region, so it is kept and thrown once all the cameras are processed
+  int nCameras=_cameras.size();
+  vector<char> failed(nCameras,0);
+  vector<cv::Exception> errors(nCameras);
+#ifdef USE_OMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int c=0; c<nCameras; c++)
+  {
+    try
+    {
+      _mdetectors[c].detect(frames[c],_markers[c],_cameras[c],_markerSize,_setYPerperdicular);
+      _bdetectors[c].detect(_markers[c],_bconf,_boards[c]);
+      //board corners seen by this camera
+      Board &board=_boards[c];
+      _objPoints[c].create(4*board.size(),3,CV_32FC1);
+      _imgPoints[c].create(4*board.size(),2,CV_32FC1);
+      for (size_t i=0; i<board.size(); i++)
+      {
+        const MarkerInfo &info=_bconf.getMarkerInfo(board[i].id);
+        for (int p=0; p<4; p++)
+        {
+          float *obj=_objPoints[c].ptr<float>(i*4+p);
+          float *img=_imgPoints[c].ptr<float>(i*4+p);
+          obj[0]=info[p].x*metersPerUnit;
+          obj[1]=info[p].y*metersPerUnit;
+          obj[2]=info[p].z*metersPerUnit;
+          img[0]=board[i][p].x;
+          img[1]=board[i][p].y;
+        }
+      }
+    }
+    catch (cv::Exception &ex)
+    {
+      errors[c]=ex;
+      failed[c]=1;
+    }
+    catch (std::exception &ex)
+    {
+      errors[c]=cv::Exception(9001,ex.what(),"RigDetector::detect",__FILE__,__LINE__);
+      failed[c]=1;
+    }
+  }
+  for (int c=0; c<nCameras; c++)
+    if (failed[c]) throw errors[c];
+
+  //markers of the board seen by any camera
+  vector<bool> seen(_bconf.size(),false);
+  for (int c=0; c<nCameras; c++)
+    for (size_t i=0; i<_boards[c].size(); i++)
+      seen[_bconf.getIndexOfMarkerId(_boards[c][i].id)]=true;
+  int nSeen=0;
+  for (size_t i=0; i<seen.size(); i++)
+    if (seen[i]) nSeen++;
+
+  _poseValid=false;
+  _rmsError=-1;
+  if (nSeen>0 && metersPerUnit>0)
+    _poseValid=estimatePose();
+  if (!_poseValid)
+  {
+    for (int i=0; i<3; i++) _Rvec.at<float>(i)=_Tvec.at<float>(i)=-999999;
+    for (int c=0; c<nCameras; c++)
+      for (int i=0; i<3; i++) _boards[c].Rvec.at<float>(i)=_boards[c].Tvec.at<float>(i)=-999999;
+  }
+  return float(nSeen)/float(_bconf.size());
+}
+
+/*!
+ * Returns the sum of squared reprojection errors of all the cameras for the board pose passed.
+ * If residuals is not NULL, the errors (x and y of each corner) are written in it
+ */
+double RigDetector::reprojectionError(const double rvec[3],const double tvec[3],double *residuals)
+{
+  double sum=0;
+  vector<Point2f> projected;
+  for (size_t c=0; c<_cameras.size(); c++)
+  {
+    if (_objPoints[c].rows==0) continue;
+    Mat rvecCam,tvecCam;
+    composePose(rvec,tvec,&_camR[c*9],&_camT[c*3],rvecCam,tvecCam);
+    _cameras[c].projectPoints(_objPoints[c],rvecCam,tvecCam,projected);
+    for (size_t p=0; p<projected.size(); p++)
+    {
+      const float *img=_imgPoints[c].ptr<float>(p);
+      double ex=projected[p].x-img[0],ey=projected[p].y-img[1];
+      sum+=ex*ex+ey*ey;
+      if (residuals)
+      {
+        *residuals++=ex;
+        *residuals++=ey;
+      }
+    }
+  }
+  return sum;
+}
+
+/*!
+ * Estimates the pose of the board in the rig from the corners seen by all the cameras. The
+ * initial solution is obtained with the camera that sees more corners, and then it is refined
+ * with Levenberg-Marquardt using all of them
+ */
+bool RigDetector::estimatePose()
+{
+  //initial solution
+  int best=-1,nResiduals=0;
+  for (size_t c=0; c<_cameras.size(); c++)
+  {
+    nResiduals+=2*_objPoints[c].rows;
+    if (_objPoints[c].rows>0 && (best==-1 || _objPoints[c].rows>_objPoints[best].rows))
+      best=c;
+  }
+  if (best==-1) return false;
+
+  const CameraParameters &cp=_cameras[best];
+  Mat imgPoints=_imgPoints[best];
+  if (cp.DistorsionModel==CameraParameters::FISHEYE)
+  {
+    //OpenCV does not know the model, so the corners are undistorted first
+    vector<Point2f> ideal(imgPoints.rows);
+    for (int i=0; i<imgPoints.rows; i++)
+      ideal[i]=Point2f(imgPoints.at<float>(i,0),imgPoints.at<float>(i,1));
+    cp.undistortPoints(ideal,ideal);
+    imgPoints=Mat(imgPoints.rows,2,CV_32FC1,&ideal[0]).clone();
+  }
+  Mat rvecCam,tvecCam,Rcb;
+  solvePnP(_objPoints[best],imgPoints,cp.CameraMatrix,cp.getOpenCVDistorsion(),rvecCam,tvecCam);
+  rvecCam.convertTo(rvecCam,CV_64F);
+  tvecCam.convertTo(tvecCam,CV_64F);
+  Rodrigues(rvecCam,Rcb);
+  //from the camera to the rig: Rb=Rc^t*Rcb, tb=Rc^t*(tcb-tc)
+  const double *Rc=&_camR[best*9],*tc=&_camT[best*3];
+  Mat Rb(3,3,CV_64FC1);
+  double params[6];
+  for (int i=0; i<3; i++)
+  {
+    for (int j=0; j<3; j++)
+    {
+      double sum=0;
+      for (int k=0; k<3; k++) sum+=Rc[k*3+i]*Rcb.at<double>(k,j);
+      Rb.at<double>(i,j)=sum;
+    }
+    params[3+i]=0;
+    for (int k=0; k<3; k++) params[3+i]+=Rc[k*3+i]*(tvecCam.at<double>(k,0)-tc[k]);
+  }
+  Mat rb;
+  Rodrigues(Rb,rb);
+  for (int i=0; i<3; i++) params[i]=rb.at<double>(i,0);
+
+  //refinement
+  vector<double> residuals(nResiduals),perturbed(nResiduals);
+  Mat J(nResiduals,6,CV_64FC1);
+  double error=reprojectionError(params,params+3,&residuals[0]);
+  double lambda=1e-3;
+  const double eps=1e-4;
+  for (int iter=0; iter<20; iter++)
+  {
+    //numerical jacobian
+    for (int k=0; k<6; k++)
+    {
+      double aux[6];
+      for (int i=0; i<6; i++) aux[i]=params[i];
+      aux[k]+=eps;
+      reprojectionError(aux,aux+3,&perturbed[0]);
+      for (int r=0; r<nResiduals; r++)
+        J.at<double>(r,k)=(perturbed[r]-residuals[r])/eps;
+    }
+    Mat JtJ(6,6,CV_64FC1),Jtr(6,1,CV_64FC1);
+    for (int i=0; i<6; i++)
+    {
+      double sum=0;
+      for (int r=0; r<nResiduals; r++) sum+=J.at<double>(r,i)*residuals[r];
+      Jtr.at<double>(i,0)=-sum;
+      for (int j=i; j<6; j++)
+      {
+        sum=0;
+        for (int r=0; r<nResiduals; r++) sum+=J.at<double>(r,i)*J.at<double>(r,j);
+        JtJ.at<double>(i,j)=JtJ.at<double>(j,i)=sum;
+      }
+    }
+    //look for a damping that reduces the error
+    bool improved=false;
+    double newError=error;
+    for (int t=0; t<10 && !improved; t++)
+    {
+      Mat A=JtJ.clone(),delta;
+      for (int i=0; i<6; i++) A.at<double>(i,i)+=lambda*std::max(JtJ.at<double>(i,i),1e-12);
+      if (solve(A,Jtr,delta,DECOMP_CHOLESKY))
+      {
+        double candidate[6];
+        for (int i=0; i<6; i++) candidate[i]=params[i]+delta.at<double>(i,0);
+        newError=reprojectionError(candidate,candidate+3,&perturbed[0]);
+        if (newError<error)
+        {
+          improved=true;
+          for (int i=0; i<6; i++) params[i]=candidate[i];
+          residuals.swap(perturbed);
+          lambda=std::max(lambda/10,1e-9);
+        }
+      }
+      if (!improved) lambda*=10;
+    }
+    if (!improved) break;
+    bool converged=error-newError<1e-10*error;
+    error=newError;
+    if (converged) break;
+  }
+  _rmsError=sqrt(error/(nResiduals/2));
+
+  //now, rotate 90 deg in X so that Y axis points up (see BoardDetector)
+  if (_setYPerperdicular)
+  {
+    Rodrigues(Mat(3,1,CV_64FC1,params),Rb);
+    //R*RX, with RX the rotation of -90 deg around X
+    for (int i=0; i<3; i++)
+    {
+      double r1=Rb.at<double>(i,1),r2=Rb.at<double>(i,2);
+      Rb.at<double>(i,1)=-r2;
+      Rb.at<double>(i,2)=r1;
+    }
+    Rodrigues(Rb,rb);
+    for (int i=0; i<3; i++) params[i]=rb.at<double>(i,0);
+  }
+
+  for (int i=0; i<3; i++)
+  {
+    _Rvec.at<float>(i)=params[i];
+    _Tvec.at<float>(i)=params[3+i];
+  }
+  //the pose in each camera
+  for (size_t c=0; c<_cameras.size(); c++)
+  {
+    composePose(params,params+3,&_camR[c*9],&_camT[c*3],rvecCam,tvecCam);
+    _boards[c].Rvec=rvecCam;
+    _boards[c].Tvec=tvecCam;
+  }
+  return true;
+}
+
+}
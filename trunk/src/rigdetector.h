@@ -0,0 +1,197 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _Aruco_RigDetector_H
+#define _Aruco_RigDetector_H
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include "exports.h"
+#include "board.h"
+#include "boarddetector.h"
+#include "cameraparameters.h"
+#include "markerdetector.h"
+namespace aruco
+{
+
+/**\brief Detects a board with a rig of several synchronized cameras.
+ *
+ * Each camera has its own intrinsics (CameraParameters) and its pose in the rig, i.e., the
+ * rotation and translation vectors that transform a point from the rig reference system to
+ * the camera one (as the Rvec,Tvec of a marker transform from the marker to the camera).
+ *
+ * For each set of synchronized frames, the markers are detected in all the images (in parallel
+ * if USE_OMP is defined, one camera per thread) and then the pose of the board in the rig
+ * reference system is estimated jointly, minimizing the reprojection error of the corners seen
+ * by all the cameras.
+ * \code
+
+  RigDetector RD;
+  RD.readRigFile("rig.yml");
+  RD.setBoardConfiguration(BC,markerSize);
+  ...
+  float prob=RD.detect(frames);//one image per camera
+  if (prob>0.3)
+    for (size_t c=0;c<RD.getNumCameras();c++)
+      CvDrawingUtils::draw3dAxis(frames[c],RD.getDetectedBoard(c),RD.getCameraParameters(c));
+
+ \endcode
+ *
+ * The rig file is a YAML file as:
+ * \code
+aruco_rig_ncameras: 2
+aruco_rig_cameras:
+   - { intrinsics: "cam0.yml", rvec: [ 0., 0., 0. ], tvec: [ 0., 0., 0. ] }
+   - { intrinsics: "cam1.yml", rvec: [ 0., 0.1, 0. ], tvec: [ -0.2, 0., 0. ] }
+ \endcode
+ * where the intrinsics are files of the OpenCV calibration utility (see
+ * CameraParameters::readFromXMLFile). Relative paths are relative to the rig file.
+ */
+class ARUCO_EXPORTS RigDetector
+{
+  public:
+
+    /**See BoardDetector::setYPerperdicular
+     */
+    RigDetector(bool setYPerperdicular=true);
+
+    /**Sets the cameras of the rig
+     * @param cameras intrinsics of each camera
+     * @param Rvecs,Tvecs pose of each camera: transform from the rig to the camera
+     */
+    void setCameras(const std::vector<CameraParameters> &cameras,const std::vector<cv::Mat> &Rvecs,
+      const std::vector<cv::Mat> &Tvecs)throw(cv::Exception);
+
+    /**Reads the cameras of the rig from a rig file (see the class description)
+     */
+    void readRigFile(const std::string &path)throw(cv::Exception);
+
+    /**Saves the cameras poses to a rig file. The intrinsics of camera i are saved in the files
+     * passed, if any. Otherwise, they are saved next to the rig file as <rig>_cam<i>.yml
+     */
+    void saveRigFile(const std::string &path,
+      std::vector<std::string> intrinsicsFiles=std::vector<std::string>())throw(cv::Exception);
+
+    /**Sets the board to be detected
+     * @param bc board configuration
+     * @param markerSizeMeters size of the markers, required if bc is expressed in pixels
+     */
+    void setBoardConfiguration(const BoardConfiguration &bc,float markerSizeMeters=-1);
+
+    /**Detects the markers in the images and estimates the pose of the board in the rig
+     * @param frames one image per camera, in the order of the cameras
+     * @return fraction of the markers of the board seen by at least one camera
+     */
+    float detect(const std::vector<cv::Mat> &frames)throw(cv::Exception);
+
+    /**Indicates whether the pose of the board was estimated in the last call to detect
+     */
+    bool isPoseValid()const
+    {
+      return _poseValid;
+    }
+
+    /**Returns the number of cameras
+     */
+    size_t getNumCameras()const
+    {
+      return _cameras.size();
+    }
+
+    /**Returns the intrinsics of the camera indicated
+     */
+    const CameraParameters &getCameraParameters(int cam)const
+    {
+      return _cameras[cam];
+    }
+
+    /**Returns the pose of the camera indicated in the rig
+     */
+    void getCameraPose(int cam,cv::Mat &Rvec,cv::Mat &Tvec)const;
+
+    /**Returns the internal marker detector of the camera indicated
+     */
+    MarkerDetector &getMarkerDetector(int cam)
+    {
+      return _mdetectors[cam];
+    }
+
+    /**Returns the markers detected by the camera indicated
+     */
+    std::vector<Marker> &getDetectedMarkers(int cam)
+    {
+      return _markers[cam];
+    }
+
+    /**Returns the markers of the board seen by the camera indicated. Its Rvec and Tvec are the
+     * joint pose of the board expressed in the camera reference system
+     */
+    Board &getDetectedBoard(int cam)
+    {
+      return _boards[cam];
+    }
+
+    /**Returns the pose of the board in the rig reference system
+     */
+    const PoseVector &getRvec()const
+    {
+      return _Rvec;
+    }
+    const PoseVector &getTvec()const
+    {
+      return _Tvec;
+    }
+
+    /**Returns the RMS reprojection error (pixels) of the last pose estimated
+     */
+    double getReprojectionError()const
+    {
+      return _rmsError;
+    }
+
+  private:
+    bool _setYPerperdicular;
+    std::vector<CameraParameters> _cameras;
+    std::vector<double> _camR,_camT;  //rotation matrix (9) and translation (3) of each camera
+    std::vector<MarkerDetector> _mdetectors;
+    std::vector<BoardDetector> _bdetectors;
+    std::vector<std::vector<Marker> > _markers;
+    std::vector<Board> _boards;
+    BoardConfiguration _bconf;
+    float _markerSize;
+    PoseVector _Rvec,_Tvec;
+    bool _poseValid;
+    double _rmsError;
+    //corners of the board seen by each camera: object points (board, meters) and image points
+    std::vector<cv::Mat> _objPoints,_imgPoints;
+
+    double reprojectionError(const double rvec[3],const double tvec[3],double *residuals);
+    bool estimatePose();
+};
+
+}
+#endif
@@ -0,0 +1,494 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "syntheticframegenerator.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+using namespace cv;
+namespace aruco
+{
+
+namespace
+{
+
+/*!
+ *  
+ */
+float length(const Point3f &p)
+{
+  return sqrt(p.x*p.x+p.y*p.y+p.z*p.z);
+}
+
+/*!
+ * R*p+t, being R a CV_64F 3x3 matrix
+ */
+Point3f transformPoint(const Mat &R,const Point3f &t,const Point3f &p)
+{
+  const double *r=R.ptr<double>(0);
+  return Point3f(r[0]*p.x+r[1]*p.y+r[2]*p.z+t.x,r[3]*p.x+r[4]*p.y+r[5]*p.z+t.y,
+    r[6]*p.x+r[7]*p.y+r[8]*p.z+t.z);
+}
+
+/*!
+ * sorts by decreasing depth
+ */
+bool isFarther(const pair<float,int> &a,const pair<float,int> &b)
+{
+  return a.first>b.first;
+}
+
+}
+
+/*!
+ *  
+ */
+SyntheticFrameGenerator::Params::Params()
+{
+  minDistance=0.3;
+  maxDistance=2;
+  maxTilt=60;
+  background=0.7;
+  blackLevel=30;
+  whiteLevel=220;
+  lightGradient=0.3;
+  blurSigma=0.7;
+  noiseSigma=3;
+  occlusionProbability=0;
+  maxOcclusion=0.3;
+  distort=true;
+}
+
+/*!
+ *  
+ */
+SyntheticFrameGenerator::SyntheticFrameGenerator(const CameraParameters &cp,const Params &params,
+  MarkerImageCache &cache) throw (cv::Exception)
+{
+  if (!cp.isValid())
+    throw cv::Exception(9001,"invalid camera parameters",
+      "SyntheticFrameGenerator::SyntheticFrameGenerator",__FILE__,__LINE__);
+  _cp=cp;
+  _params=params;
+  _cache=&cache;
+  cp.CameraMatrix.convertTo(_K,CV_64F);
+  cp.Distorsion.convertTo(_dist,CV_64F);
+
+  //undistorted position of each pixel, so that the markers are rendered directly in the
+  //distorted image
+  if (countNonZero(_dist)!=0)
+  {
+    vector<Point2f> pixels(cp.CamSize.width*cp.CamSize.height);
+    Point2f *p=&pixels[0];
+    for (int y=0; y<cp.CamSize.height; y++)
+      for (int x=0; x<cp.CamSize.width; x++,p++)
+        *p=Point2f(x,y);
+    cp.undistortPoints(pixels,pixels);
+    Mat(pixels).reshape(2,cp.CamSize.height).copyTo(_idealMap);
+  }
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::project(const vector<Point3f> &points,vector<Point2f> &res,
+  bool distort)const
+{
+  Mat zero=Mat::zeros(3,1,CV_64F);
+  if (distort) _cp.projectPoints(Mat(points),zero,zero,res);
+  else projectPoints(points,zero,zero,_K,Mat::zeros(4,1,CV_64F),res);
+}
+
+/*!
+ *  
+ */
+cv::Rect SyntheticFrameGenerator::projectedBox(const Point3f corners[4])const
+{
+  //the sides are curved by the distortion, so several points of each one are projected
+  const int nSteps=4;
+  vector<Point3f> points;
+  for (int i=0; i<4; i++)
+    for (int s=0; s<nSteps; s++)
+      points.push_back(corners[i]+(corners[(i+1)%4]-corners[i])*(float(s)/nSteps));
+  vector<Point2f> proj;
+  project(points,proj,_params.distort && !_idealMap.empty());
+  float minX=proj[0].x,maxX=proj[0].x,minY=proj[0].y,maxY=proj[0].y;
+  for (size_t i=1; i<proj.size(); i++)
+  {
+    minX=std::min(minX,proj[i].x);
+    maxX=std::max(maxX,proj[i].x);
+    minY=std::min(minY,proj[i].y);
+    maxY=std::max(maxY,proj[i].y);
+  }
+  //margin for the interpolation
+  return Rect(Point(cvFloor(minX)-2,cvFloor(minY)-2),Point(cvCeil(maxX)+3,cvCeil(maxY)+3));
+}
+
+/*!
+ * Each pixel of the image is mapped to the marker image by the undistortion map and the inverse of
+ * the homography of the marker, and the marker is sampled with bilinear interpolation. The image
+ * is the reflectance (CV_32F)
+ */
+void SyntheticFrameGenerator::renderMarker(Mat &image,int id,const Point3f corners[4],
+  Rect &bbox)const
+{
+  const Dictionary &dict=_cache->getDictionary();
+  int nCells=dict.getGridSize()+2*dict.getBorderWidth();
+  vector<Point2f> ideal;
+  project(vector<Point3f>(corners,corners+4),ideal,false);
+  //the marker image is rendered with a power of two pixels per cell, close to the projected
+  //size, so that few different images are cached
+  float side=0;
+  for (int i=0; i<4; i++)
+  {
+    Point2f d=ideal[(i+1)%4]-ideal[i];
+    side=std::max(side,sqrt(d.x*d.x+d.y*d.y));
+  }
+  int cellPx=1;
+  while (cellPx*nCells<side && cellPx<64) cellPx*=2;
+  int S=cellPx*nCells;
+  Mat marker=_cache->get(id,S);
+
+  Point2f src[4]={Point2f(0,0),Point2f(S,0),Point2f(S,S),Point2f(0,S)};
+  Point2f dst[4]={ideal[0],ideal[1],ideal[2],ideal[3]};
+  Mat Hinv;
+  getPerspectiveTransform(dst,src).convertTo(Hinv,CV_64F);
+  const double *h=Hinv.ptr<double>(0);
+
+  bbox=projectedBox(corners)&Rect(0,0,image.cols,image.rows);
+  bool distort=_params.distort && !_idealMap.empty();
+  for (int y=bbox.y; y<bbox.y+bbox.height; y++)
+  {
+    float *row=image.ptr<float>(y);
+    for (int x=bbox.x; x<bbox.x+bbox.width; x++)
+    {
+      Point2f q=distort?_idealMap.at<Point2f>(y,x):Point2f(x,y);
+      double w=h[6]*q.x+h[7]*q.y+h[8];
+      if (w<=0) continue;
+      double u=(h[0]*q.x+h[1]*q.y+h[2])/w,v=(h[3]*q.x+h[4]*q.y+h[5])/w;
+      if (u<0 || v<0 || u>=S || v>=S) continue;
+      //bilinear interpolation, the centers of the pixels are at .5
+      u-=0.5;
+      v-=0.5;
+      int x0=cvFloor(u),y0=cvFloor(v);
+      float ax=u-x0,ay=v-y0;
+      int x1=std::min(x0+1,S-1),y1=std::min(y0+1,S-1);
+      x0=std::max(x0,0);
+      y0=std::max(y0,0);
+      const uchar *r0=marker.ptr<uchar>(y0),*r1=marker.ptr<uchar>(y1);
+      float val=(1-ay)*((1-ax)*r0[x0]+ax*r0[x1])+ay*((1-ax)*r1[x0]+ax*r1[x1]);
+      row[x]=val/255.f;
+    }
+  }
+}
+
+/*!
+ * The pose is calculated from the corners with the same reference system as
+ * Marker::calculateExtrinsics: the corners 0,1,2,3 are (-s/2,-s/2), (-s/2,s/2), (s/2,s/2) and
+ * (s/2,-s/2)
+ */
+Marker SyntheticFrameGenerator::createGroundTruth(int id,float size,const Point3f corners[4])const
+{
+  vector<Point2f> proj;
+  project(vector<Point3f>(corners,corners+4),proj,_params.distort && !_idealMap.empty());
+  Marker m(proj,id);
+  m.ssize=size;
+  Point3f center=(corners[0]+corners[1]+corners[2]+corners[3])*0.25f;
+  Point3f ax=corners[3]-corners[0],ay=corners[1]-corners[0];
+  ax=ax*(1.f/length(ax));
+  ay=ay*(1.f/length(ay));
+  Point3f az(ax.y*ay.z-ax.z*ay.y,ax.z*ay.x-ax.x*ay.z,ax.x*ay.y-ax.y*ay.x);
+  Mat R(3,3,CV_32F);
+  for (int i=0; i<3; i++)
+  {
+    R.at<float>(i,0)=i==0?ax.x:(i==1?ax.y:ax.z);
+    R.at<float>(i,1)=i==0?ay.x:(i==1?ay.y:ay.z);
+    R.at<float>(i,2)=i==0?az.x:(i==1?az.y:az.z);
+  }
+  Rodrigues(R,m.Rvec);
+  m.Tvec.create(3,1,CV_32F);
+  m.Tvec.at<float>(0)=center.x;
+  m.Tvec.at<float>(1)=center.y;
+  m.Tvec.at<float>(2)=center.z;
+  return m;
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::renderScene(const vector<int> &ids,const vector<float> &sizes,
+  const vector<Point3f> &corners,RNG &rng,Frame &frame)const
+{
+  Size imSize=_cp.CamSize;
+  Mat reflectance(imSize,CV_32FC1);
+  reflectance.setTo(Scalar(_params.background));
+
+  //the markers are rendered from the farthest to the nearest one
+  vector<pair<float,int> > order(ids.size());
+  for (size_t i=0; i<ids.size(); i++)
+  {
+    const Point3f *c=&corners[i*4];
+    order[i]=make_pair(c[0].z+c[1].z+c[2].z+c[3].z,i);
+  }
+  std::sort(order.begin(),order.end(),isFarther);
+
+  frame.markers.resize(ids.size());
+  frame.occluded.assign(ids.size(),false);
+  for (size_t o=0; o<order.size(); o++)
+  {
+    int i=order[o].second;
+    Rect bbox;
+    renderMarker(reflectance,ids[i],&corners[i*4],bbox);
+    frame.markers[i]=createGroundTruth(ids[i],sizes[i],&corners[i*4]);
+    //occlusion by a band of random reflectance that enters the marker from one of its sides
+    if (rng.uniform(0.f,1.f)<_params.occlusionProbability && bbox.area()>0)
+    {
+      float f=rng.uniform(0.05f,std::max(_params.maxOcclusion,0.05f));
+      Rect occ=bbox;
+      switch (rng.uniform(0,4))
+      {
+        case 0: occ.width=std::max(1,cvRound(bbox.width*f)); break;
+        case 1: occ.height=std::max(1,cvRound(bbox.height*f)); break;
+        case 2:
+          occ.x+=bbox.width-std::max(1,cvRound(bbox.width*f));
+          occ.width=bbox.x+bbox.width-occ.x;
+          break;
+        default:
+          occ.y+=bbox.height-std::max(1,cvRound(bbox.height*f));
+          occ.height=bbox.y+bbox.height-occ.y;
+      }
+      Mat roi=reflectance(occ);
+      roi.setTo(Scalar(rng.uniform(0.f,1.f)));
+      frame.occluded[i]=true;
+    }
+  }
+
+  //illumination: grey levels of the reflectance with a linear gradient in a random direction
+  float angle=rng.uniform(0.f,float(2*CV_PI));
+  float gx=cos(angle)*_params.lightGradient/imSize.width;
+  float gy=sin(angle)*_params.lightGradient/imSize.height;
+  float range=_params.whiteLevel-_params.blackLevel;
+  for (int y=0; y<imSize.height; y++)
+  {
+    float *row=reflectance.ptr<float>(y);
+    for (int x=0; x<imSize.width; x++)
+    {
+      float light=1+gx*(x-imSize.width/2)+gy*(y-imSize.height/2);
+      row[x]=(_params.blackLevel+range*row[x])*light;
+    }
+  }
+  if (_params.blurSigma>0)
+    GaussianBlur(reflectance,reflectance,Size(0,0),_params.blurSigma);
+  if (_params.noiseSigma>0)
+  {
+    Mat noise(imSize,CV_32FC1);
+    rng.fill(noise,RNG::NORMAL,Scalar(0),Scalar(_params.noiseSigma));
+    reflectance+=noise;
+  }
+  reflectance.convertTo(frame.image,CV_8U);
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::generate(const vector<int> &ids,float markerSize,RNG &rng,
+  Frame &frame)const throw (cv::Exception)
+{
+  if (markerSize<=0)
+    throw cv::Exception(9001,"invalid marker size","SyntheticFrameGenerator::generate",
+      __FILE__,__LINE__);
+  const int maxAttempts=20;
+  double fx=_K.at<double>(0,0),fy=_K.at<double>(1,1),cx=_K.at<double>(0,2),cy=_K.at<double>(1,2);
+  float h=markerSize/2;
+  Point3f obj[4]={Point3f(-h,-h,0),Point3f(-h,h,0),Point3f(h,h,0),Point3f(h,-h,0)};
+  //frontal marker: its x axis is the y of the camera, and its z axis points to the camera
+  Mat R0=Mat::zeros(3,3,CV_64F);
+  R0.at<double>(1,0)=1;
+  R0.at<double>(0,1)=1;
+  R0.at<double>(2,2)=-1;
+  Rect imRect(0,0,_cp.CamSize.width,_cp.CamSize.height);
+
+  vector<int> placedIds;
+  vector<float> sizes;
+  vector<Point3f> corners;
+  vector<Rect> boxes;
+  for (size_t i=0; i<ids.size(); i++)
+  {
+    for (int a=0; a<maxAttempts; a++)
+    {
+      double z=rng.uniform(double(_params.minDistance),double(_params.maxDistance));
+      double u=rng.uniform(0.,double(imRect.width)),v=rng.uniform(0.,double(imRect.height));
+      //rotation in the image plane and then tilt around an axis in the image plane
+      double roll=rng.uniform(0.,2*CV_PI),phi=rng.uniform(0.,2*CV_PI);
+      double tilt=rng.uniform(0.,double(_params.maxTilt))*CV_PI/180.;
+      Mat rollVec=Mat::zeros(3,1,CV_64F),tiltVec=Mat::zeros(3,1,CV_64F);
+      rollVec.at<double>(2)=roll;
+      tiltVec.at<double>(0)=cos(phi)*tilt;
+      tiltVec.at<double>(1)=sin(phi)*tilt;
+      Mat Rroll,Rtilt;
+      Rodrigues(rollVec,Rroll);
+      Rodrigues(tiltVec,Rtilt);
+      Mat R=Rtilt*Rroll*R0;
+      Point3f t((u-cx)/fx*z,(v-cy)/fy*z,z);
+      Point3f c[4];
+      bool valid=true;
+      for (int k=0; k<4; k++)
+      {
+        c[k]=transformPoint(R,t,obj[k]);
+        if (c[k].z<=0.01) valid=false;
+      }
+      if (!valid) continue;
+      //inside the image and not overlapping the other markers
+      Rect box=projectedBox(c);
+      if ((box&imRect).area()!=box.area()) continue;
+      for (size_t b=0; b<boxes.size() && valid; b++)
+        if ((box&boxes[b]).area()>0) valid=false;
+      if (!valid) continue;
+      placedIds.push_back(ids[i]);
+      sizes.push_back(markerSize);
+      corners.insert(corners.end(),c,c+4);
+      boxes.push_back(box);
+      break;
+    }
+  }
+  renderScene(placedIds,sizes,corners,rng,frame);
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::render(const vector<Marker> &markers,RNG &rng,Frame &frame)const
+  throw (cv::Exception)
+{
+  vector<int> ids(markers.size());
+  vector<float> sizes(markers.size());
+  vector<Point3f> corners;
+  for (size_t i=0; i<markers.size(); i++)
+  {
+    const Marker &m=markers[i];
+    if (m.Rvec.total()!=3 || m.Tvec.total()!=3 || m.ssize<=0)
+      throw cv::Exception(9001,"the markers must have the pose and size set",
+        "SyntheticFrameGenerator::render",__FILE__,__LINE__);
+    Mat R;
+    Rodrigues(m.Rvec,R);
+    R.convertTo(R,CV_64F);
+    const float *t=m.Tvec.ptr<float>(0);
+    float h=m.ssize/2;
+    Point3f obj[4]={Point3f(-h,-h,0),Point3f(-h,h,0),Point3f(h,h,0),Point3f(h,-h,0)};
+    for (int k=0; k<4; k++)
+      corners.push_back(transformPoint(R,Point3f(t[0],t[1],t[2]),obj[k]));
+    ids[i]=m.id;
+    sizes[i]=m.ssize;
+  }
+  renderScene(ids,sizes,corners,rng,frame);
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::renderBoard(const BoardConfiguration &bc,const Mat &Rvec,
+  const Mat &Tvec,RNG &rng,Frame &frame)const throw (cv::Exception)
+{
+  if (!bc.isExpressedInMeters())
+    throw cv::Exception(9001,"the board must be expressed in meters",
+      "SyntheticFrameGenerator::renderBoard",__FILE__,__LINE__);
+  Mat R,T;
+  Rodrigues(Rvec,R);
+  R.convertTo(R,CV_64F);
+  Tvec.convertTo(T,CV_64F);
+  const double *t=T.ptr<double>(0);
+  vector<int> ids(bc.size());
+  vector<float> sizes(bc.size());
+  vector<Point3f> corners;
+  for (size_t i=0; i<bc.size(); i++)
+  {
+    for (int k=0; k<4; k++)
+      corners.push_back(transformPoint(R,Point3f(t[0],t[1],t[2]),bc[i][k]));
+    ids[i]=bc[i].id;
+    sizes[i]=length(bc[i][1]-bc[i][0]);
+  }
+  renderScene(ids,sizes,corners,rng,frame);
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::generateBatch(int nFrames,const vector<int> &ids,float markerSize,
+  uint64 seed,vector<Frame> &frames)const throw (cv::Exception)
+{
+  //exceptions can not leave the parallel region, so the arguments are checked here
+  if (markerSize<=0)
+    throw cv::Exception(9001,"invalid marker size","SyntheticFrameGenerator::generateBatch",
+      __FILE__,__LINE__);
+  for (size_t i=0; i<ids.size(); i++)
+    if (ids[i]<0 || ids[i]>=_cache->getDictionary().size())
+      throw cv::Exception(9001,"invalid marker id","SyntheticFrameGenerator::generateBatch",
+        __FILE__,__LINE__);
+  frames.resize(nFrames);
+#ifdef USE_OMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i=0; i<nFrames; i++)
+  {
+    RNG rng(seed+uint64(i));
+    generate(ids,markerSize,rng,frames[i]);
+  }
+}
+
+/*!
+ *  
+ */
+void SyntheticFrameGenerator::evaluate(const Frame &frame,const vector<Marker> &detected,
+  int &nFound,int &nWrong,double &cornerError)
+{
+  nFound=nWrong=0;
+  cornerError=0;
+  for (size_t i=0; i<frame.markers.size(); i++)
+    for (size_t j=0; j<detected.size(); j++)
+      if (detected[j].id==frame.markers[i].id && detected[j].size()==4)
+      {
+        nFound++;
+        for (int k=0; k<4; k++)
+        {
+          Point2f d=detected[j][k]-frame.markers[i][k];
+          cornerError+=sqrt(d.x*d.x+d.y*d.y)/4.;
+        }
+        break;
+      }
+  for (size_t j=0; j<detected.size(); j++)
+  {
+    bool found=false;
+    for (size_t i=0; i<frame.markers.size() && !found; i++)
+      found=detected[j].id==frame.markers[i].id;
+    if (!found) nWrong++;
+  }
+  if (nFound>0) cornerError/=nFound;
+}
+
+}
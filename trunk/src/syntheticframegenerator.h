@@ -0,0 +1,188 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_SyntheticFrameGenerator_H
+#define _ARUCO_SyntheticFrameGenerator_H
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include "exports.h"
+#include "marker.h"
+#include "board.h"
+#include "cameraparameters.h"
+#include "markerimagecache.h"
+namespace aruco
+{
+
+/**\brief Renders synthetic frames of markers and boards with known poses, to test the accuracy
+ * and speed of the detection without image files.
+ *
+ * The markers are projected with the camera parameters (including the distortion) and the
+ * frames are degraded with a lighting gradient, occlusions, blur and noise. The markers of the
+ * ground truth have the corners (in the same order as the detected ones), id, size and pose
+ * (Rvec, Tvec, as calculated by Marker::calculateExtrinsics).
+ *
+ * All the methods are const and the random numbers are taken from the generator passed, so that
+ * several threads may render frames at once. generateBatch() does so if the library is
+ * compiled with USE_OMP.
+ *
+ * Example of use:
+ * \code
+ * SyntheticFrameGenerator gen(camParams);
+ * SyntheticFrameGenerator::Frame frame;
+ * cv::RNG rng(0);
+ * for (int i=0; i<nFrames; i++)
+ * {
+ *   gen.generate(ids,0.1,rng,frame);
+ *   detector.detect(frame.image,markers,camParams,0.1);
+ *   SyntheticFrameGenerator::evaluate(frame,markers,nFound,nWrong,error);
+ * }
+ * \endcode
+ */
+class ARUCO_EXPORTS SyntheticFrameGenerator
+{
+  public:
+
+    /**\brief Parameters of the scenes and of the degradation of the frames
+     */
+    struct ARUCO_EXPORTS Params
+    {
+      Params();
+
+      float minDistance,maxDistance; ///< range of distances of the markers to the camera (meters)
+      float maxTilt;          ///< max angle between the marker normal and the optical axis (deg)
+      float background;       ///< reflectance of the background [0,1]
+      float blackLevel,whiteLevel; ///< grey levels of the black and white parts of the markers
+      float lightGradient;    ///< relative change of the lighting across the image [0,1]
+      float blurSigma;        ///< sigma of the gaussian blur in pixels. 0 means no blur
+      float noiseSigma;       ///< sigma of the gaussian noise in grey levels
+      float occlusionProbability; ///< probability of a marker being partially occluded
+      float maxOcclusion;     ///< max fraction of the side of a marker that is occluded
+      bool distort;           ///< indicates whether the camera distortion is applied
+    };
+
+    /**\brief A frame and its ground truth
+     */
+    struct ARUCO_EXPORTS Frame
+    {
+      cv::Mat image;                ///< CV_8UC1 image of the size of the camera
+      std::vector<Marker> markers;  ///< markers in the image
+      std::vector<bool> occluded;   ///< indicates which markers are partially occluded
+    };
+
+    /**
+     * @param cp camera parameters. The frames have its size
+     * @param params parameters of the scenes
+     * @param cache cache of the marker images. Its dictionary gives the markers rendered. A copy
+     * is not made, so it must exist while this object is employed
+     */
+    SyntheticFrameGenerator(const CameraParameters &cp,const Params &params=Params(),
+      MarkerImageCache &cache=MarkerImageCache::getDefault()) throw (cv::Exception);
+
+    /**
+     */
+    void setParams(const Params &params)
+    {
+      _params=params;
+    }
+
+    /**
+     */
+    const Params & getParams()const
+    {
+      return _params;
+    }
+
+    /**Renders a frame with the markers passed at random poses. The markers are placed so that
+     * they are inside the image and do not overlap, so some may be discarded if there is not
+     * enough room
+     * @param ids ids of the markers
+     * @param markerSize size of the markers in meters
+     * @param rng random number generator
+     * @param frame output
+     */
+    void generate(const std::vector<int> &ids,float markerSize,cv::RNG &rng,Frame &frame)const
+      throw (cv::Exception);
+
+    /**Renders a frame with the markers passed, with known poses
+     * @param markers markers with the id, ssize, Rvec and Tvec set. Their corners are ignored
+     * @param rng random number generator
+     * @param frame output. Its markers are the ones passed, with the corners projected
+     */
+    void render(const std::vector<Marker> &markers,cv::RNG &rng,Frame &frame)const
+      throw (cv::Exception);
+
+    /**Renders a frame with a board
+     * @param bc board, expressed in meters
+     * @param Rvec,Tvec pose of the board respect to the camera
+     * @param rng random number generator
+     * @param frame output
+     */
+    void renderBoard(const BoardConfiguration &bc,const cv::Mat &Rvec,const cv::Mat &Tvec,
+      cv::RNG &rng,Frame &frame)const throw (cv::Exception);
+
+    /**Renders several frames with generate(). The frame i is rendered with cv::RNG(seed+i), so
+     * that the batch does not depend on the number of threads.
+     */
+    void generateBatch(int nFrames,const std::vector<int> &ids,float markerSize,uint64 seed,
+      std::vector<Frame> &frames)const throw (cv::Exception);
+
+    /**Compares the markers detected in a frame with its ground truth
+     * @param frame frame with the ground truth
+     * @param detected markers detected
+     * @param nFound output number of markers of the ground truth detected
+     * @param nWrong output number of markers detected that are not in the ground truth
+     * @param cornerError output mean distance (pixels) between the corners of the markers found
+     * and the ones of the ground truth. 0 if none is found
+     */
+    static void evaluate(const Frame &frame,const std::vector<Marker> &detected,int &nFound,
+      int &nWrong,double &cornerError);
+
+  private:
+
+    //renders a marker given its corners in the camera reference system. Returns its bounding box
+    void renderMarker(cv::Mat &image,int id,const cv::Point3f corners[4],cv::Rect &bbox)const;
+    //projection of points in camera coordinates, with or without distortion
+    void project(const std::vector<cv::Point3f> &points,std::vector<cv::Point2f> &res,
+      bool distort)const;
+    //bounding box of the projection of a quad, including the curvature of its sides
+    cv::Rect projectedBox(const cv::Point3f corners[4])const;
+    //marker with corners and pose of a quad in camera coordinates
+    Marker createGroundTruth(int id,float size,const cv::Point3f corners[4])const;
+    //renders the markers given their corners and degrades the image
+    void renderScene(const std::vector<int> &ids,const std::vector<float> &sizes,
+      const std::vector<cv::Point3f> &corners,cv::RNG &rng,Frame &frame)const;
+
+    CameraParameters _cp;
+    cv::Mat _K,_dist;     //double versions of the camera matrix and distortion
+    cv::Mat _idealMap;    //undistorted position of each pixel (CV_32FC2). Empty if no distortion
+    Params _params;
+    MarkerImageCache *_cache;
+};
+
+}
+
+#endif
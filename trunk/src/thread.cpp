@@ -0,0 +1,119 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "thread.h"
+#if defined WIN32 || defined _WIN32 || defined WINCE
+#include <windows.h>
+#define ARUCO_WIN32_THREAD
+#else
+#include <pthread.h>
+#endif
+namespace aruco
+{
+
+//function to run and its argument, passed to the entry point of the thread
+struct ThreadTask
+{
+  void (*func)(void*);
+  void *arg;
+};
+
+#ifdef ARUCO_WIN32_THREAD
+static DWORD WINAPI threadEntry(LPVOID p)
+#else
+static void * threadEntry(void *p)
+#endif
+{
+  ThreadTask task=*(ThreadTask*)p;
+  delete (ThreadTask*)p;
+  task.func(task.arg);
+  return 0;
+}
+
+/*!
+ *  
+ */
+Thread::Thread()
+{
+  _impl=0;
+}
+
+/*!
+ *  
+ */
+Thread::~Thread()
+{
+  join();
+}
+
+/*!
+ *  
+ */
+void Thread::start(void (*func)(void*),void *arg) throw (cv::Exception)
+{
+  if (_impl!=0)
+    throw cv::Exception(9001,"the thread is already running","Thread::start",__FILE__,__LINE__);
+  ThreadTask *task=new ThreadTask;
+  task->func=func;
+  task->arg=arg;
+#ifdef ARUCO_WIN32_THREAD
+  HANDLE h=CreateThread(NULL,0,threadEntry,task,0,NULL);
+  if (h==NULL)
+  {
+    delete task;
+    throw cv::Exception(9001,"could not create the thread","Thread::start",__FILE__,__LINE__);
+  }
+  _impl=h;
+#else
+  pthread_t *t=new pthread_t;
+  if (pthread_create(t,NULL,threadEntry,task)!=0)
+  {
+    delete t;
+    delete task;
+    throw cv::Exception(9001,"could not create the thread","Thread::start",__FILE__,__LINE__);
+  }
+  _impl=t;
+#endif
+}
+
+/*!
+ *  
+ */
+void Thread::join()
+{
+  if (_impl==0) return;
+#ifdef ARUCO_WIN32_THREAD
+  WaitForSingleObject((HANDLE)_impl,INFINITE);
+  CloseHandle((HANDLE)_impl);
+#else
+  pthread_join(*(pthread_t*)_impl,NULL);
+  delete (pthread_t*)_impl;
+#endif
+  _impl=0;
+}
+
+}
@@ -0,0 +1,74 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _ARUCO_Thread_H
+#define _ARUCO_Thread_H
+#include <opencv2/core/core.hpp>
+#include "exports.h"
+namespace aruco
+{
+
+/**\brief Minimal thread, implemented with pthreads or with the Win32 API, for the background
+ * tasks of the library (e.g. DetectionLogWriter)
+ */
+class ARUCO_EXPORTS Thread
+{
+  public:
+
+    Thread();
+
+    /**Joins the thread if it is running
+     */
+    ~Thread();
+
+    /**Runs func(arg) in a new thread
+     */
+    void start(void (*func)(void*),void *arg) throw (cv::Exception);
+
+    /**Waits until the thread finishes
+     */
+    void join();
+
+    /**Indicates whether the thread has been started and not joined
+     */
+    bool isRunning()const
+    {
+      return _impl!=0;
+    }
+
+  private:
+
+    //not copyable
+    Thread(const Thread &);
+    Thread & operator=(const Thread &);
+
+    void *_impl; //pthread_t or HANDLE
+};
+
+}
+
+#endif
@@ -30,6 +30,7 @@ or implied, of Rafael Muñoz Salinas.
 #include <opencv/cv.h>
 #include <opencv/highgui.h>
 #include "arucofidmarkers.h"
+#include "boardrenderer.h"
 
 using namespace std;
 using namespace cv;
@@ -44,7 +45,7 @@ int main(int argc,char **argv)
   {
     if (argc<4)
     {
-      cerr<<"Usage: X:Y boardImage.png boardConfiguration.yml [pixSize] [Type(0: panel,1: chessboard, 2: frame)] [interMarkerDistance(0,1)]"<<endl;
+      cerr<<"Usage: X:Y boardImage.(png|tif|pgm) boardConfiguration.yml [pixSize] [Type(0: panel,1: chessboard, 2: frame)] [interMarkerDistance(0,1)]"<<endl;
       return -1;
     }
     int XSize,YSize;
@@ -61,13 +62,14 @@ int main(int argc,char **argv)
     if (argc>=6) typeBoard=atoi(argv[5]);
     //if (argc>=7) interMarkerDistance=atoi(argv[6]);
     aruco::BoardConfiguration BInfo;
-    Mat BoardImage;
+    Size imageSize;
+    Point origin;
     if (typeBoard==0)
-      BoardImage=aruco::FiducidalMarkers::createBoardImage(Size(XSize,YSize), pixSize,pixSize*0.2,BInfo);
+      aruco::FiducidalMarkers::createBoardLayout(Size(XSize,YSize), pixSize,pixSize*0.2,BInfo,imageSize,origin);
     else if (typeBoard==1)
-      BoardImage=aruco::FiducidalMarkers::createBoardImage_ChessBoard(Size(XSize,YSize), pixSize,BInfo);
+      aruco::FiducidalMarkers::createBoardLayout_ChessBoard(Size(XSize,YSize), pixSize,BInfo,imageSize,origin);
     else if (typeBoard==2)
-      BoardImage=aruco::FiducidalMarkers::createBoardImage_Frame(Size(XSize,YSize), pixSize,pixSize*0.2,BInfo);
+      aruco::FiducidalMarkers::createBoardLayout_Frame(Size(XSize,YSize), pixSize,pixSize*0.2,BInfo,imageSize,origin);
 
     else
     {
@@ -75,7 +77,14 @@ int main(int argc,char **argv)
       return -1;
     }
 
-    imwrite(argv[2],BoardImage);
+    aruco::BoardRenderer renderer(BInfo,imageSize,origin);
+    //tiff and pgm images are written by bands, so that boards of any size can be created.
+    //Other formats require the whole image in memory
+    string ext=string(argv[2]);
+    ext=ext.substr(ext.find_last_of('.')+1);
+    if (ext=="tif" || ext=="tiff" || ext=="pgm" || ext=="TIF" || ext=="TIFF" || ext=="PGM")
+      renderer.write(argv[2]);
+    else imwrite(argv[2],renderer.render());
     BInfo.saveToFile(argv[3]);
 
   }
@@ -0,0 +1,89 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+
+/// @file aruco_test_posevector.cpp
+/// Checks the lifetime and the copy semantics of the Rvec and Tvec of the markers. Returns 0 if
+/// they are right
+
+#include <iostream>
+#include "aruco.h"
+using namespace cv;
+using namespace aruco;
+using namespace std;
+
+bool check(const Mat &v,float x,float y,float z,const char *what)
+{
+  if (v.total()==3 && v.type()==CV_32FC1 && v.at<float>(0)==x && v.at<float>(1)==y &&
+      v.at<float>(2)==z)
+    return true;
+  cerr<<what<<" has wrong values"<<endl;
+  return false;
+}
+
+int main()
+{
+  try
+  {
+    vector<Marker> markers(1);
+    if (!check(markers[0].Rvec,-999999,-999999,-999999,"the initial Rvec")) return 1;
+    markers[0].Rvec.at<float>(0)=1;
+    markers[0].Rvec.at<float>(1)=2;
+    markers[0].Rvec.at<float>(2)=3;
+#ifdef ARUCO_INLINE_POSE
+    //the data is inside the marker, so that it must be cloned to keep it
+    Mat r=markers[0].Rvec.clone();
+#else
+    Mat r=markers[0].Rvec;
+#endif
+    //the marker is moved and then changed and destroyed, what must not affect r
+    markers.resize(1000);
+    markers[0].Rvec=Mat::zeros(3,1,CV_64FC1);
+    if (!check(markers[0].Rvec,0,0,0,"the Rvec assigned")) return 1;
+    markers.clear();
+    if (!check(r,1,2,3,"the matrix taken from the Rvec")) return 1;
+
+    //copies do not share the values
+    Marker m1;
+    m1.Tvec=r;
+    Marker m2(m1);
+    m2.Tvec.at<float>(0)=10;
+    m1=m2;
+    m2.Tvec.at<float>(1)=20;
+    if (!check(m1.Tvec,10,2,3,"the copied Tvec")) return 1;
+    if (!check(m2.Tvec,10,20,3,"the modified Tvec")) return 1;
+    if (!check(r,1,2,3,"the matrix assigned to the Tvec")) return 1;
+
+    cout<<"OK"<<endl;
+    return 0;
+  }
+  catch (std::exception &ex)
+  {
+    cerr<<"Exception :"<<ex.what()<<endl;
+    return 1;
+  }
+}
@@ -0,0 +1,91 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+
+/// @file aruco_test_stripes.cpp
+/// Checks that the striped mode detects a marker of the maximum size rotated 45 deg across the
+/// seams between stripes, in the same place as the detection without stripes. Returns 0 if so
+
+#include <iostream>
+#include <cmath>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "aruco.h"
+#include "arucofidmarkers.h"
+using namespace cv;
+using namespace aruco;
+using namespace std;
+int main()
+{
+  try
+  {
+    const int width=640,height=480,nStripes=4,id=213;
+    const float maxSize=0.25;
+    //the contour of a marker rotated 45 deg has about 4*side/sqrt(2) points, so the largest one
+    //accepted has a side of maxSize*width*sqrt(2), and its height is 2*maxSize*width
+    int side=int(0.9*maxSize*width*sqrt(2.));
+    Mat marker=FiducidalMarkers::createMarkerImage(id,side);
+    //the top corner is in the second stripe, and the marker goes down to the last one
+    float half=side*sqrt(2.)/2;
+    Point2f center(width/2,height/nStripes+5+half);
+    Mat M=getRotationMatrix2D(Point2f(side/2.,side/2.),45,1);
+    M.at<double>(0,2)+=center.x-side/2.;
+    M.at<double>(1,2)+=center.y-side/2.;
+    Mat image;
+    warpAffine(marker,image,M,Size(width,height),INTER_LINEAR,BORDER_CONSTANT,Scalar(255));
+
+    MarkerDetector MDetector;
+    MDetector.setMinMaxSize(0.03,maxSize);
+    vector<Marker> reference,striped;
+    MDetector.detect(image,reference);
+    MDetector.setNumberOfStripes(nStripes);
+    MDetector.detect(image,striped);
+
+    if (reference.size()!=1 || reference[0].id!=id)
+    {
+      cerr<<"the marker is not detected without stripes"<<endl;
+      return 1;
+    }
+    if (striped.size()!=1 || striped[0].id!=id)
+    {
+      cerr<<striped.size()<<" markers detected with "<<nStripes<<" stripes instead of 1"<<endl;
+      return 1;
+    }
+    for (int c=0; c<4; c++)
+      if (norm(striped[0][c]-reference[0][c])>0.5)
+      {
+        cerr<<"the corner "<<c<<" is different with stripes"<<endl;
+        return 1;
+      }
+    cout<<"OK"<<endl;
+    return 0;
+  }
+  catch (std::exception &ex)
+  {
+    cerr<<"Exception :"<<ex.what()<<endl;
+    return 1;
+  }
+}
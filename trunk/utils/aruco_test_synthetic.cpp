@@ -0,0 +1,101 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+
+/// @file aruco_test_synthetic.cpp
+/// Measures the detection rate, the accuracy of the corners and the speed of the detector with
+/// synthetic frames rendered in memory
+/// \todo Use argtable2 for arguments
+
+#include <iostream>
+#include <cstdlib>
+#include "aruco.h"
+using namespace cv;
+using namespace aruco;
+using namespace std;
+int main(int argc,char **argv)
+{
+  try
+  {
+    if (argc<3)
+    {
+      cerr<<"Usage: cameraParams.yml nFrames [markerSize] [nMarkersPerFrame] [noiseSigma] "
+        "[blurSigma] [occlusionProbability] [batchSize]"<<endl;
+      return -1;
+    }
+    CameraParameters CamParam;
+    CamParam.readFromXMLFile(argv[1]);
+    int nFrames=atoi(argv[2]);
+    float markerSize=0.1;
+    int nMarkers=5,batchSize=64;
+    SyntheticFrameGenerator::Params params;
+    if (argc>=4) markerSize=atof(argv[3]);
+    if (argc>=5) nMarkers=atoi(argv[4]);
+    if (argc>=6) params.noiseSigma=atof(argv[5]);
+    if (argc>=7) params.blurSigma=atof(argv[6]);
+    if (argc>=8) params.occlusionProbability=atof(argv[7]);
+    if (argc>=9) batchSize=atoi(argv[8]);
+
+    SyntheticFrameGenerator generator(CamParam,params);
+    MarkerDetector MDetector;
+    RNG rng(0);
+    vector<int> ids(nMarkers);
+    vector<SyntheticFrameGenerator::Frame> frames;
+    vector<Marker> Markers;
+    int nTruth=0,nFound=0,nWrong=0;
+    double cornerError=0,tickCount=0;
+    //the frames are rendered in batches (in parallel with OpenMP) and passed to the detector
+    for (int first=0; first<nFrames; first+=batchSize)
+    {
+      for (int i=0; i<nMarkers; i++) ids[i]=rng.uniform(0,1024);
+      generator.generateBatch(std::min(batchSize,nFrames-first),ids,markerSize,first,frames);
+      for (size_t f=0; f<frames.size(); f++)
+      {
+        double tick=(double)getTickCount();
+        MDetector.detect(frames[f].image,Markers,CamParam,markerSize);
+        tickCount+=(double)getTickCount()-tick;
+        int found,wrong;
+        double error;
+        SyntheticFrameGenerator::evaluate(frames[f],Markers,found,wrong,error);
+        nTruth+=frames[f].markers.size();
+        nFound+=found;
+        nWrong+=wrong;
+        cornerError+=error*found;
+      }
+    }
+    double seconds=tickCount/getTickFrequency();
+    cout<<"Frames="<<nFrames<<" markers="<<nTruth<<endl;
+    cout<<"Detected="<<nFound<<" ("<<100.*nFound/std::max(nTruth,1)<<"%) wrong="<<nWrong<<endl;
+    cout<<"Mean corner error="<<cornerError/std::max(nFound,1)<<" pix"<<endl;
+    cout<<"Detection time="<<1000.*seconds/std::max(nFrames,1)<<" ms/frame ("
+      <<nFrames/std::max(seconds,1e-9)<<" fps)"<<endl;
+  }
+  catch (std::exception &ex)
+  {
+    cout<<"Exception :"<<ex.what()<<endl;
+  }
+}
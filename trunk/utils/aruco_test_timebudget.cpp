@@ -0,0 +1,92 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+
+/// @file aruco_test_timebudget.cpp
+/// Checks that the candidates reordered by the time budget keep their contours, so that the
+/// LINES refinement moves the corners as it does without budget. Returns 0 if so
+
+#include <iostream>
+#include <cmath>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "aruco.h"
+#include "arucofidmarkers.h"
+using namespace cv;
+using namespace aruco;
+using namespace std;
+int main()
+{
+  try
+  {
+    const int width=640,height=480,side=150,id=456;
+    //a marker rotated 30 deg, so that the refined corners are not in the pixels of the contour
+    Mat marker=FiducidalMarkers::createMarkerImage(id,side);
+    Mat M=getRotationMatrix2D(Point2f(side/2.,side/2.),30,1);
+    M.at<double>(0,2)+=width/2-side/2.;
+    M.at<double>(1,2)+=height/2-side/2.;
+    Mat image;
+    warpAffine(marker,image,M,Size(width,height),INTER_LINEAR,BORDER_CONSTANT,Scalar(255));
+
+    MarkerDetector MDetector;
+    vector<Marker> unrefined,reference,budget;
+    MDetector.setTimeBudget(1000);
+    MDetector.setCornerRefinementMethod(MarkerDetector::NONE);
+    MDetector.detect(image,unrefined);
+    MDetector.setCornerRefinementMethod(MarkerDetector::LINES);
+    MDetector.detect(image,budget);
+    MDetector.setTimeBudget(0);
+    MDetector.detect(image,reference);
+
+    if (unrefined.size()!=1 || reference.size()!=1 || budget.size()!=1 || budget[0].id!=id)
+    {
+      cerr<<"the marker is not detected"<<endl;
+      return 1;
+    }
+    double moved=0;
+    for (int c=0; c<4; c++)
+    {
+      moved=std::max(moved,norm(budget[0][c]-unrefined[0][c]));
+      if (norm(budget[0][c]-reference[0][c])>1e-3)
+      {
+        cerr<<"the corner "<<c<<" is different with a time budget"<<endl;
+        return 1;
+      }
+    }
+    if (moved<1e-3)
+    {
+      cerr<<"the LINES refinement did not move the corners with a time budget"<<endl;
+      return 1;
+    }
+    cout<<"OK"<<endl;
+    return 0;
+  }
+  catch (std::exception &ex)
+  {
+    cerr<<"Exception :"<<ex.what()<<endl;
+    return 1;
+  }
+}